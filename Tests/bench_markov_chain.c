@@ -0,0 +1,117 @@
+/**
+ * Benchmark of the markov chain core on a corpus: ingest, generation and
+ * scoring throughput. Run it on the different build variants to compare
+ * them (make bench BENCH_VARIANT=...).
+ */
+#define _POSIX_C_SOURCE 200809L // For clock_gettime()
+#include "test_util.h"
+#include "../markov_score_ex3a.h"
+#include <time.h>
+
+#define INGEST_ROUNDS 5
+#define GENERATED_WORDS 500000
+#define SCORED_WINDOWS 200000
+#define WINDOW_SIZE 8
+#define NANOSECONDS 1e9
+
+static double now(void)
+{
+  struct timespec time;
+  clock_gettime (CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / NANOSECONDS;
+}
+
+static void report(const char *name, double seconds, double operations,
+                   const char *unit)
+{
+  printf ("%-12s %10.3f s %14.0f %s/s\n", name, seconds,
+          operations / seconds, unit);
+}
+
+/**
+ * Time building the chain from the corpus.
+ * @return the chain of the last round
+ */
+static MarkovChain *bench_ingest(const char *path)
+{
+  MarkovChain *markov_chain = NULL;
+  double start = now ();
+  for (int round = 0; round < INGEST_ROUNDS; round++)
+  {
+    if (markov_chain != NULL)
+    {
+      free_database (&markov_chain);
+    }
+    markov_chain = new_word_chain (true);
+    if (markov_chain == NULL || fill_word_chain (markov_chain, path))
+    {
+      return NULL;
+    }
+  }
+  report ("ingest", now () - start, INGEST_ROUNDS, "corpus");
+  return markov_chain;
+}
+
+/**
+ * Time random walks, restarting at sentence ends.
+ * @param words - filled with the generated words, for bench_scoring
+ */
+static void bench_generation(MarkovChain *markov_chain, void **words)
+{
+  double start = now ();
+  MarkovNode *current = get_first_random_node (markov_chain);
+  for (long i = 0; i < GENERATED_WORDS; i++)
+  {
+    words[i] = current->data;
+    current = get_next_random_node (current);
+    if (current == NULL || is_last_word (current->data))
+    {
+      current = get_first_random_node (markov_chain);
+    }
+  }
+  report ("generation", now () - start, GENERATED_WORDS, "words");
+}
+
+/**
+ * Time scoring windows of generated text, in batches.
+ */
+static void bench_scoring(MarkovChain *markov_chain, void **words)
+{
+  void ***sequences = malloc (SCORED_WINDOWS * sizeof (void **));
+  int *lengths = malloc (SCORED_WINDOWS * sizeof (int));
+  double *scores = malloc (SCORED_WINDOWS * sizeof (double));
+  for (long i = 0; i < SCORED_WINDOWS; i++)
+  {
+    sequences[i] = words + i * (GENERATED_WORDS - WINDOW_SIZE)
+                           / SCORED_WINDOWS;
+    lengths[i] = WINDOW_SIZE;
+  }
+  double start = now ();
+  score_sequences (markov_chain, sequences, lengths, SCORED_WINDOWS, scores);
+  report ("scoring", now () - start, SCORED_WINDOWS, "sequences");
+  free (sequences);
+  free (lengths);
+  free (scores);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: bench_markov_chain <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  srand (1);
+  MarkovChain *markov_chain = bench_ingest (argv[1]);
+  if (markov_chain == NULL)
+  {
+    fprintf (stderr, "bench_markov_chain: cannot read %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  void **words = malloc (GENERATED_WORDS * sizeof (void *));
+  bench_generation (markov_chain, words);
+  bench_scoring (markov_chain, words);
+  free (words);
+  free_database (&markov_chain);
+  return EXIT_SUCCESS;
+}
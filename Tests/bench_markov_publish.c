@@ -0,0 +1,152 @@
+/**
+ * Benchmark of concurrent generation from a published chain: the latency
+ * of each tweet of several reader threads, with and without a writer
+ * publishing new versions meanwhile, drawing from rand() or from a random
+ * state of each reader. Reports the median, 99th percentile and maximum.
+ */
+#define _POSIX_C_SOURCE 200809L // For clock_gettime()
+#include "test_util.h"
+#include "../markov_publish_ex3a.h"
+#include <time.h>
+
+#define NUM_OF_READERS 4
+#define TWEETS_PER_READER 5000
+#define MAX_TWEET_LENGTH 20
+#define NANOSECONDS 1e9
+#define MICROSECONDS 1e6
+#define MEDIAN 0.5
+#define PERCENTILE_99 0.99
+
+static double now(void)
+{
+  struct timespec time;
+  clock_gettime (CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / NANOSECONDS;
+}
+
+// Generated tweets are not printed, only timed
+static void skip_word(void *data)
+{
+  (void) data;
+}
+
+static MarkovPublisher *publisher;
+static atomic_int readers_running;
+static bool use_random_state;
+static double latencies[NUM_OF_READERS][TWEETS_PER_READER];
+
+/**
+ * Generate TWEETS_PER_READER tweets, timing each one from taking the read
+ * lock to releasing it.
+ */
+static void *read_tweets(void *reader)
+{
+  int id = (int) (intptr_t) reader;
+  unsigned long long random_state = (unsigned long long) id + 1;
+  unsigned long long *state = use_random_state ? &random_state : NULL;
+  for (int i = 0; i < TWEETS_PER_READER; i++)
+  {
+    double start = now ();
+    int read_slot;
+    MarkovChain *markov_chain = read_lock_markov_chain (publisher,
+                                                        &read_slot);
+    MarkovNode *first = get_first_random_node_r (markov_chain, state);
+    if (first != NULL)
+    {
+      generate_tweet_r (markov_chain, first, MAX_TWEET_LENGTH, state);
+    }
+    read_unlock_markov_chain (publisher, read_slot);
+    latencies[id][i] = now () - start;
+  }
+  atomic_fetch_sub (&readers_running, 1);
+  return NULL;
+}
+
+/**
+ * Publish copies of the current version, each with one more bigram, until
+ * the readers are done.
+ * @return the number of versions published
+ */
+static int publish_versions(void)
+{
+  int num_of_versions = 0;
+  while (atomic_load (&readers_running) > 0)
+  {
+    int read_slot;
+    MarkovChain *current = read_lock_markov_chain (publisher, &read_slot);
+    MarkovChain *next = copy_markov_chain (current);
+    read_unlock_markov_chain (publisher, read_slot);
+    if (next == NULL)
+    {
+      break;
+    }
+    MarkovNode *first = get_first_random_node (next);
+    MarkovNode *second = get_first_random_node (next);
+    if (first != NULL && second != NULL)
+    {
+      add_node_to_frequency_list (first, second);
+    }
+    publish_markov_chain (publisher, next);
+    num_of_versions++;
+  }
+  return num_of_versions;
+}
+
+static int compare_latencies(const void *first, const void *second)
+{
+  double difference = *(const double *) first - *(const double *) second;
+  return (difference > 0) - (difference < 0);
+}
+
+/**
+ * Run the readers, and the writer if asked to, then report the latencies.
+ */
+static void bench_readers(const char *name, bool with_writer)
+{
+  pthread_t readers[NUM_OF_READERS];
+  atomic_store (&readers_running, NUM_OF_READERS);
+  for (intptr_t i = 0; i < NUM_OF_READERS; i++)
+  {
+    pthread_create (&readers[i], NULL, read_tweets, (void *) i);
+  }
+  int num_of_versions = with_writer ? publish_versions () : 0;
+  for (int i = 0; i < NUM_OF_READERS; i++)
+  {
+    pthread_join (readers[i], NULL);
+  }
+  int num_of_tweets = NUM_OF_READERS * TWEETS_PER_READER;
+  double *sorted = &latencies[0][0];
+  qsort (sorted, num_of_tweets, sizeof (double), compare_latencies);
+  printf ("%-24s p50 %8.1f us  p99 %8.1f us  max %9.1f us  %d versions\n",
+          name, sorted[(int) (num_of_tweets * MEDIAN)] * MICROSECONDS,
+          sorted[(int) (num_of_tweets * PERCENTILE_99)] * MICROSECONDS,
+          sorted[num_of_tweets - 1] * MICROSECONDS, num_of_versions);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: bench_markov_publish <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  srand (1);
+  MarkovChain *markov_chain = new_markov_chain (skip_word, compare_words,
+                                                free, copy_word,
+                                                is_last_word, hash_word);
+  if (markov_chain == NULL || fill_word_chain (markov_chain, argv[1]))
+  {
+    fprintf (stderr, "bench_markov_publish: cannot read %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  publisher = new_markov_publisher (markov_chain);
+  printf ("%d readers, %d tweets each\n", NUM_OF_READERS, TWEETS_PER_READER);
+  use_random_state = false;
+  bench_readers ("rand()", false);
+  bench_readers ("rand(), publishing", true);
+  use_random_state = true;
+  bench_readers ("own state", false);
+  bench_readers ("own state, publishing", true);
+  free_markov_publisher (&publisher);
+  return EXIT_SUCCESS;
+}
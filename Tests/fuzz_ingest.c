@@ -0,0 +1,124 @@
+/**
+ * Fuzz target of the ingest path: fill_database on arbitrary input, then
+ * walking the resulting chain the way tweets are generated.
+ *
+ * Built with libFuzzer (clang -fsanitize=fuzzer) when FUZZING_ENGINE is
+ * defined. Otherwise a standalone driver runs the given input files and
+ * then deterministic random inputs, for compilers without libFuzzer.
+ */
+#define _POSIX_C_SOURCE 200809L // For fmemopen()
+#include "../markov_words_ex3a.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#define RANDOM_INPUTS 20000
+#define MAX_RANDOM_INPUT_SIZE 4096
+#define MAX_INPUT_FILE_SIZE (1 << 20)
+#define WALKS_PER_INPUT 4
+#define MAX_WALK_LENGTH 20
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  // The first byte chooses the number of words to read
+  int words_to_read = READ_ALL_WORDS;
+  if (size > 0)
+  {
+    words_to_read = data[0] % 2 == 0 ? READ_ALL_WORDS : data[0];
+    data++;
+    size--;
+  }
+  if (size == 0)
+  {
+    return 0;
+  }
+  FILE *fp = fmemopen ((void *) data, size, "r");
+  if (fp == NULL)
+  {
+    return 0;
+  }
+  MarkovChain *markov_chain = new_markov_chain (print_word, compare_words,
+                                                free, copy_word,
+                                                is_last_word, hash_word);
+  if (markov_chain != NULL
+      && fill_database (fp, words_to_read, markov_chain) == 0)
+  {
+    for (int walk = 0; walk < WALKS_PER_INPUT; walk++)
+    {
+      MarkovNode *current = get_first_random_node (markov_chain);
+      for (int i = 1; current != NULL && i < MAX_WALK_LENGTH; i++)
+      {
+        if (is_last_word (current->data))
+        {
+          break;
+        }
+        current = get_next_random_node (current);
+      }
+    }
+  }
+  if (markov_chain != NULL)
+  {
+    free_database (&markov_chain);
+  }
+  fclose (fp);
+  return 0;
+}
+
+#ifndef FUZZING_ENGINE
+
+/**
+ * Run the target on the content of a file.
+ * @return 0 in case of success, 1 if the file cannot be read
+ */
+static int run_file(const char *path)
+{
+  static uint8_t input[MAX_INPUT_FILE_SIZE];
+  FILE *fp = fopen (path, "rb");
+  if (fp == NULL)
+  {
+    return 1;
+  }
+  size_t size = fread (input, 1, MAX_INPUT_FILE_SIZE, fp);
+  fclose (fp);
+  LLVMFuzzerTestOneInput (input, size);
+  return 0;
+}
+
+/**
+ * Run the target on random inputs made of the bytes that matter to the
+ * ingest: word characters, separators, sentence ends and long lines.
+ */
+static void run_random_inputs(void)
+{
+  static const char alphabet[] = "ab.. \t\n\r\n\0\xff#@";
+  static uint8_t input[MAX_RANDOM_INPUT_SIZE];
+  for (int run = 0; run < RANDOM_INPUTS; run++)
+  {
+    size_t size = (size_t) rand () % MAX_RANDOM_INPUT_SIZE;
+    for (size_t i = 0; i < size; i++)
+    {
+      input[i] = (uint8_t) alphabet[rand () % (sizeof (alphabet) - 1)];
+    }
+    LLVMFuzzerTestOneInput (input, size);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  srand (1);
+  for (int i = 1; i < argc; i++)
+  {
+    if (run_file (argv[i]))
+    {
+      fprintf (stderr, "fuzz_ingest: cannot read %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+  run_random_inputs ();
+  printf ("fuzz_ingest: %d files and %d random inputs passed\n", argc - 1,
+          RANDOM_INPUTS);
+  return EXIT_SUCCESS;
+}
+
+#endif /* FUZZING_ENGINE */
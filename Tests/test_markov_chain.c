@@ -0,0 +1,287 @@
+/**
+ * Differential tests of the markov chain core against a simple reference
+ * model, on randomly generated corpora.
+ */
+#include "test_util.h"
+
+#define NUM_OF_CORPORA 40
+#define MAX_REFERENCE_WORDS 64
+#define MAX_WORD_SIZE 8
+#define MAX_CORPUS_LINES 60
+#define MAX_LINE_WORDS 25
+#define LAST_WORD_ONE_IN 5
+#define MIN_EXPECTED_DRAWS 20
+#define MIN_SAMPLED_DRAWS 20000
+#define SAMPLED_NODES 10
+#define FIRST_NODE_DRAWS 50000
+
+/**
+ * @brief The reference model: words in order of first appearance, and a
+ * dense table of bigram counts.
+ */
+typedef struct ReferenceModel
+{
+    char words[MAX_REFERENCE_WORDS][MAX_WORD_SIZE + 2];
+    int num_of_words;
+    int counts[MAX_REFERENCE_WORDS][MAX_REFERENCE_WORDS];
+} ReferenceModel;
+
+static int reference_add_word(ReferenceModel *model, const char *word)
+{
+  for (int i = 0; i < model->num_of_words; i++)
+  {
+    if (strcmp (model->words[i], word) == 0)
+    {
+      return i;
+    }
+  }
+  strcpy (model->words[model->num_of_words], word);
+  return model->num_of_words++;
+}
+
+static int reference_total(ReferenceModel *model, int word)
+{
+  int total = 0;
+  for (int i = 0; i < model->num_of_words; i++)
+  {
+    total += model->counts[word][i];
+  }
+  return total;
+}
+
+/**
+ * Make a vocabulary of random words, some of them ending sentences.
+ */
+static int random_vocabulary(char vocabulary[][MAX_WORD_SIZE + 2])
+{
+  int size = 2 + rand () % (MAX_REFERENCE_WORDS - 2);
+  for (int i = 0; i < size; i++)
+  {
+    int length = 1 + rand () % MAX_WORD_SIZE;
+    for (int j = 0; j < length; j++)
+    {
+      // A small alphabet, so words share prefixes and collide
+      vocabulary[i][j] = (char) ('a' + rand () % 4);
+    }
+    vocabulary[i][length] = '\0';
+    if (rand () % LAST_WORD_ONE_IN == 0)
+    {
+      strcat (vocabulary[i], ".");
+    }
+  }
+  return size;
+}
+
+/**
+ * Feed a random corpus to both the chain and the reference model.
+ */
+static void build_random_corpus(MarkovChain *markov_chain,
+                                ReferenceModel *model)
+{
+  char vocabulary[MAX_REFERENCE_WORDS][MAX_WORD_SIZE + 2];
+  int size = random_vocabulary (vocabulary);
+  int num_of_lines = 1 + rand () % MAX_CORPUS_LINES;
+  for (int line = 0; line < num_of_lines; line++)
+  {
+    Node *previous = NULL;
+    int previous_word = -1;
+    int num_of_words = 1 + rand () % MAX_LINE_WORDS;
+    // Skewed draws, so frequencies differ between successors
+    for (int i = 0; i < num_of_words; i++)
+    {
+      const char *word = vocabulary[(rand () % size) * (rand () % size)
+                                    / size];
+      Node *current = add_to_database (markov_chain, (void *) word);
+      int current_word = reference_add_word (model, word);
+      CHECK(current != NULL, "add_to_database failed on %s", word);
+      if (current == NULL)
+      {
+        return;
+      }
+      if (previous != NULL)
+      {
+        CHECK(add_node_to_frequency_list (previous->data,
+                                          current->data) == 0,
+              "add_node_to_frequency_list failed");
+        model->counts[previous_word][current_word]++;
+      }
+      previous = current;
+      previous_word = current_word;
+    }
+  }
+}
+
+/**
+ * Compare the chain with the reference model.
+ */
+static void compare_with_reference(MarkovChain *markov_chain,
+                                   ReferenceModel *model)
+{
+  CHECK(markov_chain->database->size == model->num_of_words,
+        "database has %d words, reference %d",
+        markov_chain->database->size, model->num_of_words);
+  int i = 0;
+  for (Node *node = markov_chain->database->first;
+       node != NULL && i < model->num_of_words; node = node->next, i++)
+  {
+    MarkovNode *markov_node = node->data;
+    CHECK(strcmp (markov_node->data, model->words[i]) == 0,
+          "word %d is %s, reference %s", i, (char *) markov_node->data,
+          model->words[i]);
+    CHECK(get_node_from_database (markov_chain, model->words[i]) == node,
+          "lookup of %s", model->words[i]);
+    CHECK(markov_node->total_of_frequency == reference_total (model, i),
+          "total of %s", model->words[i]);
+
+    int num_of_successors = 0;
+    for (int j = 0; j < model->num_of_words; j++)
+    {
+      num_of_successors += model->counts[i][j] != 0;
+    }
+    CHECK(markov_node->frequency_list_size == num_of_successors,
+          "%s has %d successors, reference %d", model->words[i],
+          markov_node->frequency_list_size, num_of_successors);
+    for (int k = 0; k < markov_node->frequency_list_size; k++)
+    {
+      MarkovNodeFrequency *entry = &markov_node->frequency_list[k];
+      int j = reference_add_word (model, entry->markov_node->data);
+      CHECK(entry->frequency == model->counts[i][j],
+            "%s -> %s counted %d, reference %d", model->words[i],
+            model->words[j], entry->frequency, model->counts[i][j]);
+      CHECK(k == 0 || markov_node->frequency_list[k - 1].frequency
+                      >= entry->frequency,
+            "successors of %s not sorted by frequency", model->words[i]);
+    }
+  }
+  CHECK(get_node_from_database (markov_chain, "not a word") == NULL,
+        "lookup of a missing word");
+}
+
+/**
+ * Chi-square test of get_next_random_node on the node's successors.
+ */
+static void check_next_node_distribution(MarkovNode *markov_node)
+{
+  int size = markov_node->frequency_list_size;
+  int least = markov_node->frequency_list[size - 1].frequency;
+  long draws = (long) MIN_EXPECTED_DRAWS * markov_node->total_of_frequency
+               / least;
+  if (draws < MIN_SAMPLED_DRAWS)
+  {
+    draws = MIN_SAMPLED_DRAWS;
+  }
+  long *observed = calloc (size, sizeof (long));
+  double *expected = malloc (size * sizeof (double));
+  for (int k = 0; k < size; k++)
+  {
+    expected[k] = (double) markov_node->frequency_list[k].frequency
+                  / markov_node->total_of_frequency;
+  }
+  for (long draw = 0; draw < draws; draw++)
+  {
+    MarkovNode *next = get_next_random_node (markov_node);
+    int k = 0;
+    while (k < size && markov_node->frequency_list[k].markov_node != next)
+    {
+      k++;
+    }
+    CHECK(k < size, "drew a node that is not a successor");
+    if (k < size)
+    {
+      observed[k]++;
+    }
+  }
+  CHECK(chi_square_fits (observed, expected, size, draws),
+        "successors of %s do not follow their frequencies",
+        (char *) markov_node->data);
+  free (observed);
+  free (expected);
+}
+
+static void test_random_corpora(void)
+{
+  for (int corpus = 0; corpus < NUM_OF_CORPORA; corpus++)
+  {
+    bool hashed = corpus % 2 == 0;
+    MarkovChain *markov_chain = new_word_chain (hashed);
+    ReferenceModel *model = calloc (1, sizeof (ReferenceModel));
+    build_random_corpus (markov_chain, model);
+    compare_with_reference (markov_chain, model);
+
+    int sampled = 0;
+    for (Node *node = markov_chain->database->first;
+         node != NULL && sampled < SAMPLED_NODES; node = node->next)
+    {
+      if (node->data->frequency_list_size >= 2)
+      {
+        check_next_node_distribution (node->data);
+        sampled++;
+      }
+    }
+    free (model);
+    free_database (&markov_chain);
+  }
+}
+
+static void test_first_random_node(void)
+{
+  MarkovChain *markov_chain = new_word_chain (true);
+  CHECK(get_first_random_node (markov_chain) == NULL, "empty database");
+
+  // Only words that do not end a sentence can start one
+  const char *words[] = {"end.", "one", "two", "stop.", "three"};
+  int num_of_words = sizeof (words) / sizeof (words[0]);
+  for (int i = 0; i < num_of_words; i++)
+  {
+    add_to_database (markov_chain, (void *) words[i]);
+  }
+  const int starts[] = {1, 2, 4};
+  long observed[3] = {0};
+  double expected[3] = {1.0 / 3, 1.0 / 3, 1.0 / 3};
+  for (long draw = 0; draw < FIRST_NODE_DRAWS; draw++)
+  {
+    MarkovNode *first = get_first_random_node (markov_chain);
+    int k = 0;
+    while (k < 3 && strcmp (first->data, words[starts[k]]) != 0)
+    {
+      k++;
+    }
+    CHECK(k < 3, "%s cannot start a sentence", (char *) first->data);
+    if (k < 3)
+    {
+      observed[k]++;
+    }
+  }
+  CHECK(chi_square_fits (observed, expected, 3, FIRST_NODE_DRAWS),
+        "first words are not uniform");
+  free_database (&markov_chain);
+
+  markov_chain = new_word_chain (false);
+  add_to_database (markov_chain, "only.");
+  add_to_database (markov_chain, "ends.");
+  CHECK(get_first_random_node (markov_chain) == NULL,
+        "every word ends a sentence");
+  free_database (&markov_chain);
+}
+
+static void test_no_successors(void)
+{
+  MarkovChain *markov_chain = new_word_chain (true);
+  Node *first = add_to_database (markov_chain, "first");
+  Node *last = add_to_database (markov_chain, "last");
+  add_node_to_frequency_list (first->data, last->data);
+  CHECK(get_next_random_node (first->data) == last->data, "only successor");
+  CHECK(get_next_random_node (last->data) == NULL, "no successors");
+  CHECK(add_to_database (markov_chain, "first") == first, "existing word");
+  CHECK(markov_chain->database->size == 2, "no duplicate words");
+  free_database (&markov_chain);
+}
+
+int main(void)
+{
+  srand (1);
+  test_random_corpora ();
+  test_first_random_node ();
+  test_no_successors ();
+  return test_summary ("test_markov_chain");
+}
@@ -0,0 +1,276 @@
+/**
+ * Tests of copy_markov_chain, the reentrant random draws and the
+ * publication of chain versions to concurrent readers.
+ */
+#include "test_util.h"
+#include "../markov_publish_ex3a.h"
+
+#define RANDOM_DRAWS 100000
+#define RANDOM_RANGE 10
+#define NUM_OF_READERS 4
+#define NUM_OF_VERSIONS 50
+#define BASE_IDS 300
+#define BASE_BIGRAMS 2000
+#define READER_WALK 50
+#define ID_MULTIPLIER 31
+#define TWEET_LENGTH 20
+
+/**
+ * Check that copy has the same data, in the same order, and the same
+ * frequencies as markov_chain, with successors in the copy itself.
+ */
+static void compare_copy(MarkovChain *markov_chain, MarkovChain *copy)
+{
+  CHECK(copy->database->size == markov_chain->database->size,
+        "copy has %d nodes, source %d", copy->database->size,
+        markov_chain->database->size);
+  Node *copy_node = copy->database->first;
+  for (Node *node = markov_chain->database->first;
+       node != NULL && copy_node != NULL;
+       node = node->next, copy_node = copy_node->next)
+  {
+    MarkovNode *source = node->data;
+    MarkovNode *target = copy_node->data;
+    CHECK(strcmp (source->data, target->data) == 0 && source->data
+          != target->data, "copy of %s", (char *) source->data);
+    CHECK(target->frequency_list_size == source->frequency_list_size
+          && target->total_of_frequency == source->total_of_frequency,
+          "frequencies of %s", (char *) source->data);
+    for (int i = 0; i < target->frequency_list_size; i++)
+    {
+      MarkovNodeFrequency *entry = &target->frequency_list[i];
+      CHECK(entry->markov_node != source->frequency_list[i].markov_node,
+            "successor of %s is in the source", (char *) source->data);
+      CHECK(strcmp (entry->markov_node->data,
+                    source->frequency_list[i].markov_node->data) == 0
+            && entry->frequency == source->frequency_list[i].frequency,
+            "successor %d of %s", i, (char *) source->data);
+    }
+  }
+}
+
+static void test_copy(const char *path)
+{
+  for (int hashed = 1; hashed >= 0; hashed--)
+  {
+    MarkovChain *markov_chain = new_word_chain (true);
+    CHECK(fill_word_chain (markov_chain, path) == 0, "cannot read %s", path);
+    if (!hashed)
+    {
+      // Filling without the index takes quadratic time, drop it after
+      free (markov_chain->index);
+      markov_chain->index = NULL;
+      markov_chain->index_capacity = 0;
+      markov_chain->hash_func = NULL;
+    }
+    MarkovChain *copy = copy_markov_chain (markov_chain);
+    CHECK(copy != NULL, "copy failed");
+    if (copy != NULL)
+    {
+      compare_copy (markov_chain, copy);
+      free_database (&copy);
+    }
+    free_database (&markov_chain);
+  }
+
+  MarkovChain *empty = new_word_chain (true);
+  MarkovChain *copy = copy_markov_chain (empty);
+  CHECK(copy != NULL && copy->database->size == 0, "copy of an empty chain");
+  if (copy != NULL)
+  {
+    free_database (&copy);
+  }
+  free_database (&empty);
+
+  // Freeing data the chain does not copy would free it twice
+  MarkovChain *shared = new_markov_chain (print_word, compare_words,
+                                          free, NULL, is_last_word,
+                                          hash_word);
+  CHECK(copy_markov_chain (shared) == NULL, "copy of shared data");
+  free_database (&shared);
+}
+
+static intptr_t printed[TWEET_LENGTH];
+static int num_of_printed;
+
+static void record_id(void *data)
+{
+  if (num_of_printed < TWEET_LENGTH)
+  {
+    printed[num_of_printed++] = (intptr_t) data;
+  }
+}
+
+/**
+ * Generate a tweet of ids from the given state, into printed.
+ */
+static void generate_ids(MarkovChain *markov_chain, unsigned long long seed)
+{
+  unsigned long long random_state = seed;
+  num_of_printed = 0;
+  generate_tweet_r (markov_chain, get_first_random_node_r (markov_chain,
+                                                           &random_state),
+                    TWEET_LENGTH, &random_state);
+}
+
+static void test_random_state(void)
+{
+  unsigned long long first_state = 42;
+  unsigned long long second_state = 42;
+  long observed[RANDOM_RANGE] = {0};
+  double expected[RANDOM_RANGE];
+  for (int i = 0; i < RANDOM_RANGE; i++)
+  {
+    expected[i] = 1.0 / RANDOM_RANGE;
+  }
+  bool same_sequence = true;
+  for (long draw = 0; draw < RANDOM_DRAWS; draw++)
+  {
+    int number = get_random_number_r (RANDOM_RANGE, &first_state);
+    same_sequence &= number == get_random_number_r (RANDOM_RANGE,
+                                                    &second_state);
+    CHECK(number >= 0 && number < RANDOM_RANGE, "%d out of range", number);
+    if (number >= 0 && number < RANDOM_RANGE)
+    {
+      observed[number]++;
+    }
+  }
+  CHECK(same_sequence, "equal states drew different numbers");
+  CHECK(chi_square_fits (observed, expected, RANDOM_RANGE, RANDOM_DRAWS),
+        "get_random_number_r is not uniform");
+
+  // The successors are drawn by their frequencies
+  MarkovChain *markov_chain = new_word_chain (true);
+  Node *first = add_to_database (markov_chain, "first");
+  Node *rare = add_to_database (markov_chain, "rare");
+  Node *common = add_to_database (markov_chain, "common");
+  add_frequency_to_list (first->data, rare->data, 1);
+  add_frequency_to_list (first->data, common->data, 3);
+  long successors[2] = {0};
+  double frequencies[2] = {0.75, 0.25};
+  for (long draw = 0; draw < RANDOM_DRAWS; draw++)
+  {
+    successors[get_next_random_node_r (first->data, &first_state)
+               == rare->data]++;
+  }
+  CHECK(chi_square_fits (successors, frequencies, 2, RANDOM_DRAWS),
+        "get_next_random_node_r does not follow the frequencies");
+  CHECK(get_first_random_node_r (markov_chain, &first_state) != NULL,
+        "no first node");
+  free_database (&markov_chain);
+
+  // Equal states generate equal tweets
+  markov_chain = new_markov_chain (record_id, test_compare_ids, NULL, NULL,
+                                   NULL, test_hash_id);
+  Node *previous = add_to_database (markov_chain, (void *) (intptr_t) 1);
+  for (int i = 0; i < BASE_BIGRAMS; i++)
+  {
+    Node *current = add_to_database (markov_chain, (void *) (intptr_t)
+                                     (1 + rand () % BASE_IDS));
+    add_node_to_frequency_list (previous->data, current->data);
+    previous = current;
+  }
+  generate_ids (markov_chain, 1);
+  intptr_t first_tweet[TWEET_LENGTH];
+  int first_length = num_of_printed;
+  memcpy (first_tweet, printed, sizeof (printed));
+  generate_ids (markov_chain, 1);
+  CHECK(first_length == TWEET_LENGTH && num_of_printed == TWEET_LENGTH
+        && memcmp (first_tweet, printed, sizeof (printed)) == 0,
+        "generate_tweet_r differs for equal states");
+  free_database (&markov_chain);
+}
+
+static MarkovPublisher *publisher;
+static atomic_int stop_readers;
+
+/**
+ * Walk the published versions until stopped, checking each is complete.
+ */
+static void *read_versions(void *seed)
+{
+  unsigned long long random_state = (unsigned long long) (intptr_t) seed;
+  while (!atomic_load (&stop_readers))
+  {
+    int read_slot;
+    MarkovChain *markov_chain = read_lock_markov_chain (publisher,
+                                                        &read_slot);
+    // Version v adds one node to the base ones
+    CHECK(markov_chain->database->size >= BASE_IDS
+          && markov_chain->database->size <= BASE_IDS + NUM_OF_VERSIONS,
+          "version of %d nodes", markov_chain->database->size);
+    MarkovNode *current = get_first_random_node_r (markov_chain,
+                                                   &random_state);
+    for (int i = 0; current != NULL && i < READER_WALK; i++)
+    {
+      current = get_next_random_node_r (current, &random_state);
+    }
+    read_unlock_markov_chain (publisher, read_slot);
+  }
+  return NULL;
+}
+
+static void test_concurrent_publish(void)
+{
+  MarkovChain *markov_chain = new_markov_chain (test_print_id,
+                                                test_compare_ids, NULL,
+                                                NULL, NULL, test_hash_id);
+  Node *previous = add_to_database (markov_chain, (void *) (intptr_t) 1);
+  for (int i = 0; i < BASE_BIGRAMS; i++)
+  {
+    intptr_t id = 1 + (i * ID_MULTIPLIER) % BASE_IDS;
+    Node *current = add_to_database (markov_chain, (void *) id);
+    add_node_to_frequency_list (previous->data, current->data);
+    previous = current;
+  }
+  publisher = new_markov_publisher (markov_chain);
+
+  pthread_t readers[NUM_OF_READERS];
+  for (intptr_t i = 0; i < NUM_OF_READERS; i++)
+  {
+    pthread_create (&readers[i], NULL, read_versions, (void *) (i + 1));
+  }
+  for (int version = 0; version < NUM_OF_VERSIONS; version++)
+  {
+    int read_slot;
+    MarkovChain *current = read_lock_markov_chain (publisher, &read_slot);
+    MarkovChain *next = copy_markov_chain (current);
+    read_unlock_markov_chain (publisher, read_slot);
+    CHECK(next != NULL, "copy of version %d", version);
+    if (next == NULL)
+    {
+      break;
+    }
+    Node *first = add_to_database (next, (void *) (intptr_t) (1 + version
+                                                              % BASE_IDS));
+    Node *second = add_to_database (next, (void *) (intptr_t) (BASE_IDS + 1
+                                                               + version));
+    add_node_to_frequency_list (first->data, second->data);
+    publish_markov_chain (publisher, next);
+  }
+  atomic_store (&stop_readers, 1);
+  for (int i = 0; i < NUM_OF_READERS; i++)
+  {
+    pthread_join (readers[i], NULL);
+  }
+
+  int read_slot;
+  markov_chain = read_lock_markov_chain (publisher, &read_slot);
+  CHECK(markov_chain->database->size == BASE_IDS + NUM_OF_VERSIONS,
+        "last version has %d nodes", markov_chain->database->size);
+  read_unlock_markov_chain (publisher, read_slot);
+  free_markov_publisher (&publisher);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: test_markov_publish <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  test_copy (argv[1]);
+  test_random_state ();
+  test_concurrent_publish ();
+  return test_summary ("test_markov_publish");
+}
@@ -0,0 +1,133 @@
+/**
+ * Tests of sequence scoring, top successors and the successor index the
+ * lookups of both go through.
+ */
+#include "test_util.h"
+#include "../markov_score_ex3a.h"
+
+#define MANY_SUCCESSORS 200
+#define MANY_BIGRAMS 20000
+#define TOP_K 3
+#define EPSILON 1e-12
+#define WORD_SIZE 8
+#define MAX_ADDED_FREQUENCY 5
+
+/**
+ * Check that every successor of every node of markov_chain is found at its
+ * position, and that the list is sorted.
+ */
+static void check_successor_lookups(MarkovChain *markov_chain)
+{
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+  {
+    MarkovNode *markov_node = node->data;
+    for (int i = 0; i < markov_node->frequency_list_size; i++)
+    {
+      MarkovNodeFrequency *entry = &markov_node->frequency_list[i];
+      CHECK(get_node_from_frequency_list (markov_node, entry->markov_node)
+            == entry, "successor %d of %s", i, (char *) markov_node->data);
+      CHECK(i == 0 || entry[-1].frequency >= entry->frequency,
+            "successors of %s not sorted", (char *) markov_node->data);
+    }
+  }
+}
+
+static void test_successor_index(const char *path)
+{
+  MarkovChain *markov_chain = new_word_chain (true);
+  CHECK(fill_word_chain (markov_chain, path) == 0, "cannot read %s", path);
+  check_successor_lookups (markov_chain);
+  free_database (&markov_chain);
+
+  // One node with many successors, counted in random order
+  static char words[MANY_SUCCESSORS][WORD_SIZE];
+  int counts[MANY_SUCCESSORS] = {0};
+  markov_chain = new_word_chain (true);
+  Node *first = add_to_database (markov_chain, "first");
+  Node *nodes[MANY_SUCCESSORS];
+  for (int i = 0; i < MANY_SUCCESSORS; i++)
+  {
+    sprintf (words[i], "w%d", i);
+    nodes[i] = add_to_database (markov_chain, words[i]);
+  }
+  for (int i = 0; i < MANY_BIGRAMS; i++)
+  {
+    int word = (rand () % MANY_SUCCESSORS) * (rand () % MANY_SUCCESSORS)
+               / MANY_SUCCESSORS;
+    // Counts above 1 move entries past unequal ones
+    int frequency = 1 + rand () % MAX_ADDED_FREQUENCY;
+    add_frequency_to_list (first->data, nodes[word]->data, frequency);
+    counts[word] += frequency;
+  }
+  check_successor_lookups (markov_chain);
+  for (int i = 0; i < MANY_SUCCESSORS; i++)
+  {
+    MarkovNodeFrequency *entry = get_node_from_frequency_list
+        (first->data, nodes[i]->data);
+    CHECK(counts[i] == 0 ? entry == NULL
+                         : entry != NULL && entry->frequency == counts[i],
+          "%s counted %d", words[i], counts[i]);
+  }
+  CHECK(get_node_from_frequency_list (first->data, first->data) == NULL,
+        "first never follows itself");
+  free_database (&markov_chain);
+}
+
+static void test_score_sequence(void)
+{
+  MarkovChain *markov_chain = new_word_chain (true);
+  Node *a = add_to_database (markov_chain, "a");
+  Node *b = add_to_database (markov_chain, "b");
+  Node *c = add_to_database (markov_chain, "c.");
+  add_frequency_to_list (a->data, b->data, 3);
+  add_frequency_to_list (a->data, c->data, 1);
+  add_frequency_to_list (b->data, c->data, 2);
+
+  void *abc[] = {"a", "b", "c."};
+  void *ac[] = {"a", "c."};
+  void *ba[] = {"b", "a"};
+  void *unknown[] = {"d"};
+  CHECK(fabs (score_sequence (markov_chain, abc, 3) - log (0.75)) < EPSILON,
+        "score of a b c.");
+  CHECK(fabs (score_sequence (markov_chain, ac, 2) - log (0.25)) < EPSILON,
+        "score of a c.");
+  CHECK(score_sequence (markov_chain, ba, 2) == -INFINITY,
+        "b never followed by a");
+  CHECK(score_sequence (markov_chain, abc, 0) == 0, "empty sequence");
+  CHECK(score_sequence (markov_chain, abc, 1) == 0, "single known data");
+  CHECK(score_sequence (markov_chain, unknown, 1) == -INFINITY,
+        "single unknown data");
+
+  void **sequences[] = {abc, ac, ba};
+  int lengths[] = {3, 2, 2};
+  double scores[3];
+  score_sequences (markov_chain, sequences, lengths, 3, scores);
+  for (int i = 0; i < 3; i++)
+  {
+    CHECK(scores[i] == score_sequence (markov_chain, sequences[i],
+                                       lengths[i]), "batch score %d", i);
+  }
+
+  MarkovNodeFrequency *successors;
+  CHECK(get_top_successors (a->data, TOP_K, &successors) == 2
+        && successors[0].markov_node == b->data
+        && successors[1].markov_node == c->data, "top successors of a");
+  CHECK(get_top_successors (a->data, 1, &successors) == 1, "top 1 of a");
+  CHECK(get_top_successors (c->data, TOP_K, &successors) == 0,
+        "c. has no successors");
+  free_database (&markov_chain);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: test_markov_score <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  srand (1);
+  test_successor_index (argv[1]);
+  test_score_sequence ();
+  return test_summary ("test_markov_score");
+}
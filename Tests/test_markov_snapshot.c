@@ -0,0 +1,211 @@
+/**
+ * Round trip tests of compressed snapshots on the shipped corpus, and
+ * loading of truncated and corrupted snapshots.
+ */
+#include "test_util.h"
+#include "../markov_snapshot_ex3a.h"
+
+#define MAX_THREADS 4
+#define CORRUPTED_SNAPSHOTS 2000
+#define SMALL_CORPUS_WORDS 40
+#define WALKS 200
+#define MAX_WALK_LENGTH 20
+
+/**
+ * Save markov_chain into a temporary file.
+ * @return the file, at its start, NULL in case of failure
+ */
+static FILE *save_to_file(MarkovChain *markov_chain)
+{
+  FILE *fp = tmpfile ();
+  if (fp != NULL && save_database (fp, markov_chain, word_to_bytes))
+  {
+    fclose (fp);
+    return NULL;
+  }
+  if (fp != NULL)
+  {
+    rewind (fp);
+  }
+  return fp;
+}
+
+/**
+ * Load a snapshot from the given bytes.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int load_bytes(const unsigned char *bytes, size_t size,
+                      int num_of_threads)
+{
+  FILE *fp = tmpfile ();
+  if (fp == NULL)
+  {
+    return 1;
+  }
+  fwrite (bytes, 1, size, fp);
+  rewind (fp);
+  MarkovChain *markov_chain = new_word_chain (true);
+  int result = load_database (fp, markov_chain, word_from_bytes,
+                              num_of_threads);
+  free_database (&markov_chain);
+  fclose (fp);
+  return result;
+}
+
+/**
+ * Check that loaded has its nodes and every frequency list in the order of
+ * expected.
+ */
+static void compare_chain_order(MarkovChain *expected, MarkovChain *loaded)
+{
+  Node *node = expected->database->first;
+  Node *other = loaded->database->first;
+  for (int i = 0; node != NULL && other != NULL;
+       i++, node = node->next, other = other->next)
+  {
+    MarkovNode *markov_node = node->data;
+    MarkovNode *loaded_node = other->data;
+    CHECK(strcmp (markov_node->data, loaded_node->data) == 0,
+          "node %d is %s instead of %s", i, (char *) loaded_node->data,
+          (char *) markov_node->data);
+    CHECK(markov_node->frequency_list_size
+          == loaded_node->frequency_list_size, "successors of %s",
+          (char *) markov_node->data);
+    for (int k = 0; k < markov_node->frequency_list_size
+                    && k < loaded_node->frequency_list_size; k++)
+    {
+      MarkovNodeFrequency *entry = &markov_node->frequency_list[k];
+      MarkovNodeFrequency *loaded_entry = &loaded_node->frequency_list[k];
+      CHECK(strcmp (entry->markov_node->data,
+                    loaded_entry->markov_node->data) == 0
+            && entry->frequency == loaded_entry->frequency,
+            "successor %d of %s", k, (char *) markov_node->data);
+    }
+  }
+  CHECK(node == NULL && other == NULL, "number of nodes");
+}
+
+/**
+ * Check that the same seed generates the same words from both chains.
+ */
+static void compare_walks(MarkovChain *expected, MarkovChain *loaded)
+{
+  unsigned long long expected_state = 1;
+  unsigned long long loaded_state = 1;
+  for (int walk = 0; walk < WALKS; walk++)
+  {
+    MarkovNode *node = get_first_random_node_r (expected, &expected_state);
+    MarkovNode *other = get_first_random_node_r (loaded, &loaded_state);
+    for (int i = 0; node != NULL && other != NULL && i < MAX_WALK_LENGTH;
+         i++)
+    {
+      CHECK(strcmp (node->data, other->data) == 0,
+            "walk %d drew %s instead of %s", walk, (char *) other->data,
+            (char *) node->data);
+      node = node->frequency_list_size == 0 ? NULL
+             : get_next_random_node_r (node, &expected_state);
+      other = other->frequency_list_size == 0 ? NULL
+              : get_next_random_node_r (other, &loaded_state);
+    }
+  }
+}
+
+static void test_round_trip(const char *path)
+{
+  MarkovChain *markov_chain = new_word_chain (true);
+  CHECK(fill_word_chain (markov_chain, path) == 0, "cannot read %s", path);
+  for (int num_of_threads = 1; num_of_threads <= MAX_THREADS;
+       num_of_threads++)
+  {
+    FILE *fp = save_to_file (markov_chain);
+    CHECK(fp != NULL, "save failed");
+    if (fp == NULL)
+    {
+      break;
+    }
+    MarkovChain *loaded = new_word_chain (true);
+    CHECK(load_database (fp, loaded, word_from_bytes, num_of_threads)
+          == 0, "load with %d threads failed", num_of_threads);
+    compare_word_chains (markov_chain, loaded);
+    compare_chain_order (markov_chain, loaded);
+    compare_walks (markov_chain, loaded);
+    free_database (&loaded);
+    fclose (fp);
+  }
+  free_database (&markov_chain);
+
+  markov_chain = new_word_chain (true);
+  FILE *fp = save_to_file (markov_chain);
+  MarkovChain *loaded = new_word_chain (true);
+  CHECK(fp != NULL && load_database (fp, loaded, word_from_bytes, 1)
+        == 0 && loaded->database->size == 0, "empty chain");
+  free_database (&loaded);
+  free_database (&markov_chain);
+  if (fp != NULL)
+  {
+    fclose (fp);
+  }
+}
+
+static void test_corrupted_snapshots(void)
+{
+  // 5 nodes in blocks of 2^64 - 2, which used to round to 0 blocks
+  const unsigned char huge_blocks[] = {'M', 'K', 'C', 'Z', 2, 5, 0xFE,
+                                       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                       0xFF, 0xFF, 0x01};
+  CHECK(load_bytes (huge_blocks, sizeof (huge_blocks), 1) != 0,
+        "blocks larger than the nodes");
+
+  MarkovChain *markov_chain = new_word_chain (true);
+  const char *words[] = {"a", "ab", "abc", "b", "c."};
+  int num_of_words = sizeof (words) / sizeof (words[0]);
+  Node *previous = NULL;
+  for (int i = 0; i < SMALL_CORPUS_WORDS; i++)
+  {
+    Node *current = add_to_database (markov_chain, (void *) words[rand ()
+                                     % num_of_words]);
+    if (previous != NULL)
+    {
+      add_node_to_frequency_list (previous->data, current->data);
+    }
+    previous = current;
+  }
+  FILE *fp = save_to_file (markov_chain);
+  free_database (&markov_chain);
+  unsigned char snapshot[TEST_MAX_LINE];
+  size_t size = fp == NULL ? 0 : fread (snapshot, 1, TEST_MAX_LINE, fp);
+  CHECK(size > 0 && size < TEST_MAX_LINE, "small snapshot of %zu bytes",
+        size);
+  if (fp != NULL)
+  {
+    fclose (fp);
+  }
+  CHECK(load_bytes (snapshot, size, 2) == 0, "small snapshot");
+
+  for (size_t prefix = 0; prefix < size; prefix++)
+  {
+    CHECK(load_bytes (snapshot, prefix, 2) != 0,
+          "snapshot truncated to %zu bytes", prefix);
+  }
+  // Corrupted snapshots may load or not, but must not crash or leak
+  for (int i = 0; i < CORRUPTED_SNAPSHOTS && size > 0; i++)
+  {
+    unsigned char corrupted[TEST_MAX_LINE];
+    memcpy (corrupted, snapshot, size);
+    corrupted[rand () % size] = (unsigned char) rand ();
+    load_bytes (corrupted, size, 1 + i % MAX_THREADS);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: test_markov_snapshot <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  srand (1);
+  test_round_trip (argv[1]);
+  test_corrupted_snapshots ();
+  return test_summary ("test_markov_snapshot");
+}
@@ -0,0 +1,140 @@
+/**
+ * Differential tests of the bounded-memory ingest: counting the corpus
+ * with a BigramCounter at several memory and word limits must build the
+ * same chain as adding it to the chain directly.
+ */
+#include "test_util.h"
+#include "../markov_spill_ex3a.h"
+
+#define SMALL_MEMORY_LIMIT (16 * 1024)
+#define LARGE_MEMORY_LIMIT (64 * 1024 * 1024)
+
+/**
+ * Fill markov_chain with the first words_to_read words of a text file,
+ * with fill_database_in_memory_limit through counter, or with
+ * fill_database if counter is NULL.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int fill_words(MarkovChain *markov_chain, const char *path,
+                      int words_to_read, BigramCounter *counter)
+{
+  FILE *fp = fopen (path, "r");
+  if (fp == NULL)
+  {
+    return 1;
+  }
+  int result = counter == NULL
+               ? fill_database (fp, words_to_read, markov_chain)
+               : fill_database_in_memory_limit (fp, words_to_read,
+                                                markov_chain, counter);
+  fclose (fp);
+  return result;
+}
+
+static void test_memory_limits(const char *path)
+{
+  MarkovChain *expected = new_word_chain (true);
+  CHECK(fill_word_chain (expected, path) == 0, "cannot read %s", path);
+
+  const size_t limits[] = {MIN_MEMORY_LIMIT, SMALL_MEMORY_LIMIT,
+                           LARGE_MEMORY_LIMIT};
+  int num_of_limits = sizeof (limits) / sizeof (limits[0]);
+  for (int i = 0; i < num_of_limits; i++)
+  {
+    BigramCounter *counter = new_bigram_counter (limits[i]);
+    CHECK(counter != NULL, "counter of %zu bytes", limits[i]);
+    if (counter == NULL)
+    {
+      continue;
+    }
+    MarkovChain *actual = new_word_chain (true);
+    CHECK(fill_words (actual, path, READ_ALL_WORDS, counter) == 0,
+          "count with %zu bytes", limits[i]);
+    compare_word_chains (expected, actual);
+    if (limits[i] == MIN_MEMORY_LIMIT)
+    {
+      // Far more runs than the merge can read at once
+      CHECK(counter->num_of_merge_passes > 0, "merged in a single pass");
+    }
+    if (limits[i] == LARGE_MEMORY_LIMIT)
+    {
+      CHECK(counter->num_of_runs == 1 && counter->num_of_merge_passes == 0,
+            "the corpus fits in %zu bytes", limits[i]);
+    }
+    free_database (&actual);
+    free_bigram_counter (&counter);
+  }
+  free_database (&expected);
+  CHECK(new_bigram_counter (MIN_MEMORY_LIMIT - 1) == NULL, "too small limit");
+}
+
+/**
+ * Word limits must stop the count where fill_database stops, also in the
+ * middle of a line.
+ */
+static void test_word_limits(const char *path)
+{
+  const int word_limits[] = {1, 5, 37, 1000, READ_ALL_WORDS};
+  int num_of_word_limits = sizeof (word_limits) / sizeof (word_limits[0]);
+  for (int i = 0; i < num_of_word_limits; i++)
+  {
+    BigramCounter *counter = new_bigram_counter (MIN_MEMORY_LIMIT);
+    CHECK(counter != NULL, "counter of %d bytes", MIN_MEMORY_LIMIT);
+    if (counter == NULL)
+    {
+      continue;
+    }
+    MarkovChain *expected = new_word_chain (true);
+    CHECK(fill_words (expected, path, word_limits[i], NULL) == 0,
+          "cannot read %d words of %s", word_limits[i], path);
+    MarkovChain *actual = new_word_chain (true);
+    CHECK(fill_words (actual, path, word_limits[i], counter) == 0,
+          "count of %d words", word_limits[i]);
+    compare_word_chains (expected, actual);
+    free_database (&actual);
+    free_database (&expected);
+    free_bigram_counter (&counter);
+  }
+}
+
+static void test_edge_bigrams(void)
+{
+  BigramCounter *counter = new_bigram_counter (MIN_MEMORY_LIMIT);
+  const unsigned char *word = (const unsigned char *) "word";
+  // An empty data, with and without a second, and a data alone
+  count_bigram (counter, word, 0, word, 4);
+  count_bigram (counter, word, 0, NULL, 0);
+  count_bigram (counter, word, 4, word, 0);
+  count_bigram (counter, word, 4, NULL, 0);
+  count_bigram (counter, word, 4, word, 0);
+  MarkovChain *markov_chain = new_word_chain (true);
+  CHECK(merge_bigram_counter (counter, markov_chain, word_from_bytes)
+        == 0, "merge of edge bigrams");
+  Node *empty = get_node_from_database (markov_chain, "");
+  Node *full = get_node_from_database (markov_chain, "word");
+  CHECK(markov_chain->database->size == 2 && empty != NULL && full != NULL,
+        "vocabulary of edge bigrams");
+  if (empty != NULL && full != NULL)
+  {
+    MarkovNodeFrequency *entry = get_node_from_frequency_list (full->data,
+                                                               empty->data);
+    CHECK(entry != NULL && entry->frequency == 2, "word -> empty");
+    CHECK(empty->data->total_of_frequency == 1, "empty -> word");
+  }
+  free_database (&markov_chain);
+  free_bigram_counter (&counter);
+  CHECK(get_peak_resident_memory () > 0, "peak resident memory");
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: test_markov_spill <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  test_memory_limits (argv[1]);
+  test_word_limits (argv[1]);
+  test_edge_bigrams ();
+  return test_summary ("test_markov_spill");
+}
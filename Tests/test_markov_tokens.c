@@ -0,0 +1,190 @@
+/**
+ * Tests of chains over other tokens than words: integer ids packed into
+ * the data pointers, and byte n-grams of a corpus.
+ */
+#include "test_util.h"
+
+#define NUM_OF_IDS 40
+#define ID_BIGRAMS 5000
+#define ID_DRAWS 100000
+#define MISSING_ID (NUM_OF_IDS + 1)
+#define NGRAM_SIZE 4
+#define MAX_CORPUS_BYTES (64 * 1024)
+
+static void print_ngram(void *data)
+{
+  fwrite (data, 1, NGRAM_SIZE, stdout);
+}
+
+static int compare_ngrams(void *first, void *second)
+{
+  return memcmp (first, second, NGRAM_SIZE);
+}
+
+static void *copy_ngram(void *data)
+{
+  void *ngram = malloc (NGRAM_SIZE);
+  if (ngram != NULL)
+  {
+    memcpy (ngram, data, NGRAM_SIZE);
+  }
+  return ngram;
+}
+
+static size_t hash_ngram(void *data)
+{
+  return hash_bytes (FNV_OFFSET_BASIS, data, NGRAM_SIZE);
+}
+
+/**
+ * Ids 1 to NUM_OF_IDS, stored as they are: lookups, counts and sampling.
+ * Freeing the chain must not free the ids, which are not pointers.
+ */
+static void test_integer_ids(void)
+{
+  for (int hashed = 0; hashed <= 1; hashed++)
+  {
+    MarkovChain *markov_chain = new_markov_chain (test_print_id,
+                                                  test_compare_ids, NULL,
+                                                  NULL, NULL, hashed
+                                                  ? test_hash_id : NULL);
+    static int counts[NUM_OF_IDS + 1][NUM_OF_IDS + 1];
+    memset (counts, 0, sizeof (counts));
+    intptr_t previous = 1;
+    Node *previous_node = add_to_database (markov_chain, (void *) previous);
+    for (int i = 0; i < ID_BIGRAMS; i++)
+    {
+      // Skewed draws, so frequencies differ between successors
+      intptr_t id = 1 + (rand () % NUM_OF_IDS) * (rand () % NUM_OF_IDS)
+                        / NUM_OF_IDS;
+      Node *node = add_to_database (markov_chain, (void *) id);
+      CHECK(node != NULL && node->data->data == (void *) id,
+            "id %d stored as is", (int) id);
+      add_node_to_frequency_list (previous_node->data, node->data);
+      counts[previous][id]++;
+      previous = id;
+      previous_node = node;
+    }
+
+    MarkovNode *most_successors = NULL;
+    for (Node *node = markov_chain->database->first; node != NULL;
+         node = node->next)
+    {
+      MarkovNode *markov_node = node->data;
+      intptr_t id = (intptr_t) markov_node->data;
+      CHECK(get_node_from_database (markov_chain, (void *) id) == node,
+            "lookup of id %d", (int) id);
+      for (int k = 0; k < markov_node->frequency_list_size; k++)
+      {
+        MarkovNodeFrequency *entry = &markov_node->frequency_list[k];
+        intptr_t next = (intptr_t) entry->markov_node->data;
+        CHECK(entry->frequency == counts[id][next], "%d -> %d counted %d",
+              (int) id, (int) next, entry->frequency);
+      }
+      if (most_successors == NULL || markov_node->frequency_list_size
+                                     > most_successors->frequency_list_size)
+      {
+        most_successors = markov_node;
+      }
+    }
+    CHECK(get_node_from_database (markov_chain, (void *) MISSING_ID) == NULL,
+          "lookup of a missing id");
+    // Without is_last, every id can start a sequence
+    CHECK(get_first_random_node (markov_chain) != NULL, "no first id");
+
+    int size = most_successors->frequency_list_size;
+    long *observed = calloc (size, sizeof (long));
+    double *expected = malloc (size * sizeof (double));
+    for (int k = 0; k < size; k++)
+    {
+      expected[k] = (double) most_successors->frequency_list[k].frequency
+                    / most_successors->total_of_frequency;
+    }
+    for (long draw = 0; draw < ID_DRAWS; draw++)
+    {
+      MarkovNode *next = get_next_random_node (most_successors);
+      int k = 0;
+      while (k < size && most_successors->frequency_list[k].markov_node
+                         != next)
+      {
+        k++;
+      }
+      CHECK(k < size, "drew an id that is not a successor");
+      if (k < size)
+      {
+        observed[k]++;
+      }
+    }
+    CHECK(chi_square_fits (observed, expected, size, ID_DRAWS),
+          "successor ids do not follow their frequencies");
+    free (observed);
+    free (expected);
+    free_database (&markov_chain);
+  }
+}
+
+/**
+ * The overlapping n-grams of a corpus, each followed by the next one.
+ */
+static void test_byte_ngrams(const char *path)
+{
+  static unsigned char bytes[MAX_CORPUS_BYTES];
+  FILE *fp = fopen (path, "rb");
+  CHECK(fp != NULL, "cannot read %s", path);
+  if (fp == NULL)
+  {
+    return;
+  }
+  int size = (int) fread (bytes, 1, MAX_CORPUS_BYTES, fp);
+  fclose (fp);
+  CHECK(size > NGRAM_SIZE, "corpus of %d bytes", size);
+
+  MarkovChain *markov_chain = new_markov_chain (print_ngram, compare_ngrams,
+                                                free, copy_ngram, NULL,
+                                                hash_ngram);
+  Node *previous = NULL;
+  for (int i = 0; i + NGRAM_SIZE <= size; i++)
+  {
+    Node *current = add_to_database (markov_chain, bytes + i);
+    CHECK(current != NULL && current->data->data != bytes + i,
+          "n-gram at %d not copied", i);
+    if (previous != NULL)
+    {
+      add_node_to_frequency_list (previous->data, current->data);
+    }
+    previous = current;
+  }
+
+  int num_of_bigrams = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+  {
+    MarkovNode *markov_node = node->data;
+    CHECK(get_node_from_database (markov_chain, markov_node->data) == node,
+          "n-gram added twice");
+    for (int k = 0; k < markov_node->frequency_list_size; k++)
+    {
+      // Each n-gram is followed by itself shifted by one byte
+      unsigned char *next = markov_node->frequency_list[k].markov_node->data;
+      CHECK(memcmp ((unsigned char *) markov_node->data + 1, next,
+                    NGRAM_SIZE - 1) == 0, "successor is not a shift");
+    }
+    num_of_bigrams += markov_node->total_of_frequency;
+  }
+  CHECK(num_of_bigrams == size - NGRAM_SIZE, "%d bigrams of %d bytes",
+        num_of_bigrams, size);
+  free_database (&markov_chain);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: test_markov_tokens <corpus>\n");
+    return EXIT_FAILURE;
+  }
+  srand (1);
+  test_integer_ids ();
+  test_byte_ngrams (argv[1]);
+  return test_summary ("test_markov_tokens");
+}
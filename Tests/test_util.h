@@ -0,0 +1,166 @@
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include "../markov_bytes_ex3a.h"
+#include "../markov_words_ex3a.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Standard normal quantile of 1 - 1e-4, significance of the chi-square tests
+#define CHI_SQUARE_Z 3.719
+#define TEST_MAX_LINE 1000
+
+static int test_failures = 0;
+
+/**
+ * Check a condition, report it and count it as a failure if false.
+ */
+#define CHECK(condition, ...) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      fprintf (stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, \
+               #condition); \
+      fprintf (stderr, __VA_ARGS__); \
+      fprintf (stderr, "\n"); \
+      test_failures++; \
+    } \
+  } \
+  while (0)
+
+/**
+ * Callbacks of integer ids packed into the data pointers, which the chain
+ * stores as they are (no copy_func and no free_data).
+ */
+static inline void test_print_id(void *data)
+{
+  printf ("%d ", (int) (intptr_t) data);
+}
+
+static inline int test_compare_ids(void *first, void *second)
+{
+  return first != second;
+}
+
+static inline size_t test_hash_id(void *data)
+{
+  return (size_t) (intptr_t) data * FNV_PRIME;
+}
+
+/**
+ * Create an empty chain of words.
+ * @param hashed - whether the chain keeps a hash index
+ */
+static inline MarkovChain *new_word_chain(bool hashed)
+{
+  return new_markov_chain (print_word, compare_words, free, copy_word,
+                           is_last_word, hashed ? hash_word : NULL);
+}
+
+/**
+ * Fill a chain of words from a text file, like the tweets generator.
+ * @return 0 in case of success, 1 otherwise
+ */
+static inline int fill_word_chain(MarkovChain *markov_chain,
+                                  const char *path)
+{
+  FILE *fp = fopen (path, "r");
+  if (fp == NULL)
+  {
+    return 1;
+  }
+  int result = fill_database (fp, READ_ALL_WORDS, markov_chain);
+  fclose (fp);
+  return result;
+}
+
+/**
+ * Check that both chains hold the same data with the same successors and
+ * frequencies. The order of the nodes may differ.
+ */
+static inline void compare_word_chains(MarkovChain *expected,
+                                       MarkovChain *actual)
+{
+  CHECK(actual->database->size == expected->database->size,
+        "%d nodes instead of %d", actual->database->size,
+        expected->database->size);
+  for (Node *node = expected->database->first; node != NULL;
+       node = node->next)
+  {
+    MarkovNode *source = node->data;
+    Node *actual_node = get_node_from_database (actual, source->data);
+    CHECK(actual_node != NULL, "%s is missing", (char *) source->data);
+    if (actual_node == NULL)
+    {
+      continue;
+    }
+    MarkovNode *target = actual_node->data;
+    CHECK(target->frequency_list_size == source->frequency_list_size
+          && target->total_of_frequency == source->total_of_frequency,
+          "frequencies of %s", (char *) source->data);
+    for (int i = 0; i < source->frequency_list_size; i++)
+    {
+      MarkovNodeFrequency *entry = &source->frequency_list[i];
+      Node *successor = get_node_from_database (actual,
+                                                entry->markov_node->data);
+      MarkovNodeFrequency *actual_entry = successor == NULL ? NULL
+          : get_node_from_frequency_list (target, successor->data);
+      CHECK(actual_entry != NULL
+            && actual_entry->frequency == entry->frequency,
+            "%s -> %s", (char *) source->data,
+            (char *) entry->markov_node->data);
+    }
+  }
+}
+
+/**
+ * Critical value of the chi-square distribution with the given degrees
+ * of freedom at the tests' significance (Wilson-Hilferty approximation).
+ */
+static inline double chi_square_critical_value(int degrees_of_freedom)
+{
+  double k = degrees_of_freedom;
+  double term = 1 - 2 / (9 * k) + CHI_SQUARE_Z * sqrt (2 / (9 * k));
+  return k * term * term * term;
+}
+
+/**
+ * Check that observed counts fit the expected probabilities.
+ * @param observed - number of times each outcome was drawn
+ * @param expected - probability of each outcome
+ * @param num_of_outcomes - at least 2
+ * @param draws - total number of draws
+ * @return true if the chi-square test accepts the fit
+ */
+static inline bool chi_square_fits(const long *observed,
+                                   const double *expected,
+                                   int num_of_outcomes, long draws)
+{
+  double statistic = 0;
+  for (int i = 0; i < num_of_outcomes; i++)
+  {
+    double expected_count = expected[i] * draws;
+    double difference = observed[i] - expected_count;
+    statistic += difference * difference / expected_count;
+  }
+  return statistic <= chi_square_critical_value (num_of_outcomes - 1);
+}
+
+/**
+ * Report the result of a test program.
+ * @return exit code of the test program
+ */
+static inline int test_summary(const char *name)
+{
+  if (test_failures != 0)
+  {
+    fprintf (stderr, "%s: %d checks failed\n", name, test_failures);
+    return EXIT_FAILURE;
+  }
+  printf ("%s: all checks passed\n", name);
+  return EXIT_SUCCESS;
+}
+
+#endif /* _TEST_UTIL_H_ */
@@ -0,0 +1,52 @@
+#include "markov_bytes_ex3a.h"
+
+#define VARINT_PAYLOAD_BITS 7
+#define VARINT_PAYLOAD_MASK 0x7f
+#define MAX_VARINT_SHIFT 63
+
+size_t hash_bytes(size_t hash, const unsigned char *bytes, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
+int encode_varint(uint64_t value, unsigned char bytes[MAX_VARINT_SIZE])
+{
+  int size = 0;
+  do
+  {
+    unsigned char byte = value & VARINT_PAYLOAD_MASK;
+    value >>= VARINT_PAYLOAD_BITS;
+    if (value != 0)
+    {
+      byte |= VARINT_CONTINUE_BIT;
+    }
+    bytes[size++] = byte;
+  }
+  while (value != 0);
+  return size;
+}
+
+int decode_varint(const unsigned char **pos, const unsigned char *end,
+                  uint64_t *value)
+{
+  *value = 0;
+  for (int shift = 0; shift <= MAX_VARINT_SHIFT;
+       shift += VARINT_PAYLOAD_BITS)
+  {
+    if (*pos == end)
+    {
+      return 1;
+    }
+    unsigned char byte = *(*pos)++;
+    *value |= (uint64_t) (byte & VARINT_PAYLOAD_MASK) << shift;
+    if ((byte & VARINT_CONTINUE_BIT) == 0)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
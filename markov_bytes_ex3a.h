@@ -0,0 +1,46 @@
+#ifndef _MARKOV_BYTES_H_
+#define _MARKOV_BYTES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte helpers shared by the snapshot, spill and words modules: FNV-1a
+ * hashing and LEB128 varints (7 payload bits per byte, low bits first, the
+ * high bit set on every byte but the last).
+ */
+
+#define FNV_OFFSET_BASIS ((size_t) 14695981039346656037ULL)
+#define FNV_PRIME ((size_t) 1099511628211ULL)
+#define VARINT_CONTINUE_BIT 0x80
+// Bytes of the longest varint of a uint64_t
+#define MAX_VARINT_SIZE 10
+
+/**
+ * Hash bytes with FNV-1a, continuing from the given hash.
+ * @param hash - FNV_OFFSET_BASIS, or the hash of the preceding bytes
+ * @param bytes - bytes to hash, may be NULL if size is 0
+ * @param size - number of bytes
+ * @return the hash
+ */
+size_t hash_bytes(size_t hash, const unsigned char *bytes, size_t size);
+
+/**
+ * Encode value as a varint.
+ * @param value - value to encode
+ * @param bytes - where to write the varint
+ * @return the number of bytes written
+ */
+int encode_varint(uint64_t value, unsigned char bytes[MAX_VARINT_SIZE]);
+
+/**
+ * Decode the varint at *pos, and move *pos past it.
+ * @param pos - position of the varint
+ * @param end - end of the readable bytes
+ * @param value - where to store the value
+ * @return 0 in case of success, 1 if the varint is truncated or too long
+ */
+int decode_varint(const unsigned char **pos, const unsigned char *end,
+                  uint64_t *value);
+
+#endif /* _MARKOV_BYTES_H_ */
@@ -2,8 +2,99 @@
 #include "markov_chain_ex3a.h"
 #include "string.h"
 #include "stdlib.h"
+#include <limits.h>
+#include <stdint.h>
 
 #define IS_NOT_ON_LIST -1
+#define INITIAL_INDEX_CAPACITY 64
+#define SPLITMIX_INCREMENT 0x9E3779B97F4A7C15ULL
+#define SPLITMIX_FIRST_MULTIPLIER 0xBF58476D1CE4E5B9ULL
+#define SPLITMIX_SECOND_MULTIPLIER 0x94D049BB133111EBULL
+// Shorter frequency lists are scanned instead of indexed
+#define MIN_INDEXED_SUCCESSORS 8
+#define INITIAL_SUCCESSOR_CAPACITY 16
+// The successor index is at most 3/4 full
+#define SUCCESSOR_LOAD_NUMERATOR 3
+#define SUCCESSOR_LOAD_DENOMINATOR 4
+// A slot of the successor index holds a position in the list plus one
+#define EMPTY_SUCCESSOR_SLOT 0
+#define POINTER_HASH_SHIFT 32
+
+MarkovChain *new_markov_chain(print_func print_func, comp_func comp_func,
+                              free_data free_data, copy_func copy_func,
+                              is_last is_last, hash_func hash_func)
+{
+  MarkovChain *markov_chain = malloc (sizeof (*markov_chain));
+  if (markov_chain == NULL)
+  {
+    return NULL;
+  }
+  LinkedList *linked_list = malloc (sizeof (*linked_list));
+  if (linked_list == NULL)
+  {
+    free (markov_chain);
+    return NULL;
+  }
+  *linked_list = (LinkedList) {NULL, NULL, 0};
+  *markov_chain = (MarkovChain) {linked_list, print_func, comp_func,
+                                 free_data, copy_func, is_last, hash_func,
+                                 NULL, 0};
+  return markov_chain;
+}
+
+/**
+ * Find the slot of data_ptr in the hash index: the slot holding its node,
+ * or the empty slot where it should be inserted.
+ * @param markov_chain the chain, must have an allocated index
+ * @param data_ptr the data to look for
+ * @return index of the slot
+ */
+static int find_index_slot(MarkovChain *markov_chain, void *data_ptr)
+{
+  size_t mask = (size_t) markov_chain->index_capacity - 1;
+  size_t slot = markov_chain->hash_func (data_ptr) & mask;
+  while (markov_chain->index[slot] != NULL &&
+         markov_chain->comp_func (markov_chain->index[slot]->data->data,
+                                  data_ptr) != 0)
+  {
+    slot = (slot + 1) & mask;
+  }
+  return (int) slot;
+}
+
+/**
+ * Make room in the hash index for one more node, keeping it at most half
+ * full.
+ * @param markov_chain the chain
+ * @return 0 on success, 1 in case of allocation error
+ */
+static int reserve_index_slot(MarkovChain *markov_chain)
+{
+  if ((markov_chain->database->size + 1) * 2
+      <= markov_chain->index_capacity)
+  {
+    return 0;
+  }
+  int new_capacity = markov_chain->index_capacity == 0
+                     ? INITIAL_INDEX_CAPACITY
+                     : markov_chain->index_capacity * 2;
+  Node **new_index = calloc (new_capacity, sizeof (Node *));
+  if (new_index == NULL)
+  {
+    return 1;
+  }
+  free (markov_chain->index);
+  markov_chain->index = new_index;
+  markov_chain->index_capacity = new_capacity;
+  // Rehash all the nodes into the new table
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+  {
+    markov_chain->index[find_index_slot (markov_chain, node->data->data)]
+        = node;
+  }
+  return 0;
+}
 
 /**
 * Check if data_ptr is in database. If so, return the Node wrapping it in
@@ -13,13 +104,22 @@
  * @return Pointer to the Node wrapping given data, NULL if state not in
  * database.
  */
-Node* get_node_from_database(MarkovChain *markov_chain, char *data_ptr)
+Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr)
 {
+  if (markov_chain->hash_func != NULL)
+  {
+    if (markov_chain->index_capacity == 0)
+    {
+      return NULL;
+    }
+    return markov_chain->index[find_index_slot (markov_chain, data_ptr)];
+  }
+
   Node *node_in_database = markov_chain->database->first;
   // Check all the nodes in database
   while (node_in_database != NULL)
   {
-    if(strcmp(node_in_database->data->data, data_ptr) == 0)
+    if(markov_chain->comp_func(node_in_database->data->data, data_ptr) == 0)
     {
       return node_in_database;
     }
@@ -34,20 +134,18 @@ Node* get_node_from_database(MarkovChain *markov_chain, char *data_ptr)
 }
 
 /**
-* If data_ptr in markov_chain, return it's node. Otherwise, create new
- * node, add to end of markov_chain's database and return it.
- * @param markov_chain the chain to look in its database
- * @param data_ptr the data to look for
- * @return Node wrapping given data_ptr in given chain's database,
- * returns NULL in case of memory allocation failure.
+ * Add a new node holding data to the end of markov_chain's database.
+ * @param markov_chain the chain to add to
+ * @param data the data of the node, stored as is
+ * @return the new Node, NULL in case of memory allocation failure (data
+ * is not freed).
  */
-Node* add_to_database(MarkovChain *markov_chain, char *data_ptr)
+static Node* add_new_node(MarkovChain *markov_chain, void *data)
 {
-  // Check if the node already exists in the database
-  Node *existing_node = get_node_from_database(markov_chain, data_ptr);
-  if (existing_node)
+  // Make sure the new node will fit in the hash index
+  if (markov_chain->hash_func != NULL && reserve_index_slot (markov_chain))
   {
-    return existing_node;
+    return NULL;
   }
 
   // Allocate memory for a new MarkovNode
@@ -58,48 +156,95 @@ Node* add_to_database(MarkovChain *markov_chain, char *data_ptr)
     return NULL;
   }
 
-  // Allocate memory for the data (word)
-  char *word = malloc(strlen(data_ptr) + 1);
-  if (word == NULL)
-  {
-    // Allocation failed, free the MarkovNode memory
-    free(markov_node);
-    return NULL;
-  }
-
-  // Copy the data into the newly allocated memory
-  strcpy(word, data_ptr);
-
   // Set the data field of the MarkovNode
-  markov_node->data = word;
+  markov_node->data = data;
 
   // Add the MarkovNode to the linked list/database
   if (add(markov_chain->database, markov_node) != 0)
   {
     // If adding to the database failed, free allocated memory
-    free(word);
-    word = NULL;
     free(markov_node);
     markov_node = NULL;
     return NULL;
   }
 
+  if (markov_chain->hash_func != NULL)
+  {
+    markov_chain->index[find_index_slot (markov_chain, data)]
+        = markov_chain->database->last;
+  }
+
   // Initialize the frequency list and other fields for the last node
   markov_chain->database->last->data->frequency_list_size = 0;
   markov_chain->database->last->data->total_of_frequency = 0;
   markov_chain->database->last->data->frequency_list = NULL;
+  markov_chain->database->last->data->successor_index = NULL;
+  markov_chain->database->last->data->successor_index_capacity = 0;
 
   // Return the last node added to the database
   return markov_chain->database->last;
 }
 
+/**
+* If data_ptr in markov_chain, return it's node. Otherwise, create new
+ * node, add to end of markov_chain's database and return it.
+ * @param markov_chain the chain to look in its database
+ * @param data_ptr the data to look for
+ * @return Node wrapping given data_ptr in given chain's database,
+ * returns NULL in case of memory allocation failure.
+ */
+Node* add_to_database(MarkovChain *markov_chain, void *data_ptr)
+{
+  // Check if the node already exists in the database
+  Node *existing_node = get_node_from_database(markov_chain, data_ptr);
+  if (existing_node)
+  {
+    return existing_node;
+  }
+
+  // Copy the data, or keep the pointer itself if the chain does not own it
+  void *data = data_ptr;
+  if (markov_chain->copy_func != NULL)
+  {
+    data = markov_chain->copy_func (data_ptr);
+    if (data == NULL)
+    {
+      // Allocation failed
+      return NULL;
+    }
+  }
+
+  Node *new_node = add_new_node (markov_chain, data);
+  if (new_node == NULL && data != data_ptr
+      && markov_chain->free_data != NULL)
+  {
+    // If adding to the database failed, free the copy
+    markov_chain->free_data (data);
+  }
+  return new_node;
+}
+
+Node* add_data_to_database(MarkovChain *markov_chain, void *data)
+{
+  Node *existing_node = get_node_from_database(markov_chain, data);
+  if (existing_node)
+  {
+    return existing_node;
+  }
+  return add_new_node (markov_chain, data);
+}
 
+/**
+ * Find markov_node in the given frequency list. Every data has exactly one
+ * node in the database, so nodes are compared by address.
+ * @return index of markov_node in the list, IS_NOT_ON_LIST if not there
+ */
 int is_node_in_frequency_list(MarkovNodeFrequency *list_frequency,int
-frequency_list_size, char *word)
+frequency_list_size, MarkovNode *markov_node)
 {
   for (int i = 0; i < frequency_list_size; i++)
   {
-    if (strcmp(list_frequency[i].markov_node->data,word) == 0)
+    if (list_frequency[i].markov_node == markov_node)
     {
       return i;
     }
@@ -109,35 +254,207 @@ frequency_list_size, char *word)
 }
 
 /**
- * Add the second markov_node to the frequency list of the first markov_node.
- * If already in list, update it's occurrence frequency value.
- * @param first_node
- * @param second_node
- * @return success/failure: 0 if the process was successful, 1 if in
- * case of allocation error.
+ * Find the slot of successor in the successor index of markov_node: the
+ * slot holding its position, or the empty slot where it should be
+ * inserted. Slots only hold positions, the successor at a position is read
+ * from the frequency list, so the list and the index must agree.
+ * @param markov_node the node, must have an allocated index
+ * @param successor the successor to look for
+ * @return index of the slot
  */
+static size_t find_successor_slot(MarkovNode *markov_node,
+                                  MarkovNode *successor)
+{
+  size_t mask = (size_t) markov_node->successor_index_capacity - 1;
+  // Nodes are aligned, mix the high bits of the address into the low ones
+  uint64_t hash = (uint64_t) (uintptr_t) successor * SPLITMIX_INCREMENT;
+  size_t slot = (size_t) (hash ^ (hash >> POINTER_HASH_SHIFT)) & mask;
+  unsigned int *index = markov_node->successor_index;
+  while (index[slot] != EMPTY_SUCCESSOR_SLOT
+         && markov_node->frequency_list[index[slot] - 1].markov_node
+            != successor)
+  {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
 
-int add_node_to_frequency_list(MarkovNode *first_node
-    , MarkovNode *second_node)
+/**
+ * Record the position of the successor at position in the frequency list
+ * of markov_node, if the list is indexed.
+ */
+static void index_successor(MarkovNode *markov_node, int position)
 {
-  int index_in_frequency_list;
-  index_in_frequency_list = is_node_in_frequency_list
-      (first_node->frequency_list,first_node->frequency_list_size,
-       second_node->data);
-  // In case the word is already in list
-  if (index_in_frequency_list != IS_NOT_ON_LIST)
+  if (markov_node->successor_index != NULL)
+  {
+    MarkovNode *successor = markov_node->frequency_list[position].markov_node;
+    markov_node->successor_index[find_successor_slot (markov_node,
+                                                      successor)]
+        = (unsigned int) position + 1;
+  }
+}
+
+/**
+ * Make the successor index of markov_node fit num_of_successors successors
+ * while at most 3/4 full, rebuilding it from the frequency list if needed.
+ * Lists shorter than MIN_INDEXED_SUCCESSORS are not indexed.
+ * @return 0 on success, 1 in case of allocation error (the index is left
+ * as is)
+ */
+static int reserve_successor_index(MarkovNode *markov_node,
+                                   int num_of_successors)
+{
+  long needed_slots = (long) num_of_successors * SUCCESSOR_LOAD_DENOMINATOR;
+  if (num_of_successors < MIN_INDEXED_SUCCESSORS
+      || needed_slots <= (long) markov_node->successor_index_capacity
+                         * SUCCESSOR_LOAD_NUMERATOR)
+  {
+    return 0;
+  }
+  int capacity = INITIAL_SUCCESSOR_CAPACITY;
+  while ((long) capacity * SUCCESSOR_LOAD_NUMERATOR < needed_slots)
+  {
+    capacity *= 2;
+  }
+  unsigned int *index = calloc (capacity, sizeof (unsigned int));
+  if (index == NULL)
+  {
+    return 1;
+  }
+  free (markov_node->successor_index);
+  markov_node->successor_index = index;
+  markov_node->successor_index_capacity = capacity;
+  for (int i = 0; i < markov_node->frequency_list_size; i++)
+  {
+    index_successor (markov_node, i);
+  }
+  return 0;
+}
+
+int index_frequency_list(MarkovNode *markov_node)
+{
+  free (markov_node->successor_index);
+  markov_node->successor_index = NULL;
+  markov_node->successor_index_capacity = 0;
+  return reserve_successor_index (markov_node,
+                                  markov_node->frequency_list_size);
+}
+
+/**
+ * Find second_node in the frequency list of first_node, through the
+ * successor index if the list has one.
+ * @return index of second_node in the list, IS_NOT_ON_LIST if not there
+ */
+static int find_in_frequency_list(MarkovNode *first_node,
+                                  MarkovNode *second_node)
+{
+  if (first_node->successor_index == NULL)
+  {
+    return is_node_in_frequency_list (first_node->frequency_list,
+                                      first_node->frequency_list_size,
+                                      second_node);
+  }
+  unsigned int position = first_node->successor_index
+      [find_successor_slot (first_node, second_node)];
+  return position == EMPTY_SUCCESSOR_SLOT ? IS_NOT_ON_LIST
+                                          : (int) position - 1;
+}
+
+MarkovNodeFrequency *get_node_from_frequency_list(MarkovNode *first_node,
+                                                  MarkovNode *second_node)
+{
+  int index = find_in_frequency_list (first_node, second_node);
+  return index == IS_NOT_ON_LIST ? NULL : &first_node->frequency_list[index];
+}
+
+/**
+ * Binary search in a frequency list sorted by descending frequency.
+ * @param list_frequency the list to search
+ * @param end search in [0, end)
+ * @param frequency frequency to compare with
+ * @return the first index in [0, end) with a lower frequency, end if none
+ */
+static int first_index_below_frequency(MarkovNodeFrequency *list_frequency,
+                                       int end, int frequency)
+{
+  int start = 0;
+  while (start < end)
+  {
+    int middle = start + (end - start) / 2;
+    if (list_frequency[middle].frequency >= frequency)
+    {
+      start = middle + 1;
+    }
+    else
+    {
+      end = middle;
+    }
+  }
+  return start;
+}
 
+/**
+ * Move the element at index from to index to (to <= from) in the frequency
+ * list of markov_node, shifting the elements in between one place forward.
+ * The slot of each element is found while the list and the index still
+ * agree on its position, then updated as the element moves.
+ */
+static void move_frequency_forward(MarkovNode *markov_node, int from, int to)
+{
+  MarkovNodeFrequency *list_frequency = markov_node->frequency_list;
+  unsigned int *index = markov_node->successor_index;
+  MarkovNodeFrequency moved = list_frequency[from];
+  size_t moved_slot = 0;
+  if (index != NULL)
+  {
+    moved_slot = find_successor_slot (markov_node, moved.markov_node);
+  }
+  // All the elements in between have the same frequency, one swap is enough
+  if (list_frequency[to].frequency == list_frequency[from - 1].frequency)
+  {
+    if (index != NULL)
+    {
+      index[find_successor_slot (markov_node, list_frequency[to].markov_node)]
+          = (unsigned int) from + 1;
+      index[moved_slot] = (unsigned int) to + 1;
+    }
+    list_frequency[from] = list_frequency[to];
+    list_frequency[to] = moved;
+    return;
+  }
+  if (index == NULL)
+  {
+    memmove (list_frequency + to + 1, list_frequency + to,
+             (from - to) * sizeof (MarkovNodeFrequency));
+  }
+  // Shift from the end, so the elements not shifted yet are still at their
+  // indexed positions. Only moved_slot is stale meanwhile, and the moved
+  // element is not searched for again.
+  for (int i = from - 1; index != NULL && i >= to; i--)
+  {
+    index[find_successor_slot (markov_node, list_frequency[i].markov_node)]
+        = (unsigned int) i + 2;
+    list_frequency[i + 1] = list_frequency[i];
+  }
+  list_frequency[to] = moved;
+  if (index != NULL)
   {
-    // Increase the frequency in 1
-    first_node->frequency_list[index_in_frequency_list].frequency+=1;
+    index[moved_slot] = (unsigned int) to + 1;
+  }
+}
 
-    // Increase the total frequencies in 1
-    first_node->total_of_frequency+=1;
-    return  0;
+int add_frequency_to_list(MarkovNode *first_node, MarkovNode *second_node,
+                          int frequency)
+{
+  if (frequency <= 0 || first_node->total_of_frequency > INT_MAX - frequency)
+  {
+    return 1;
   }
 
+  int index_in_frequency_list;
+  index_in_frequency_list = find_in_frequency_list (first_node, second_node);
   // In case the word is a new word
-  else
+  if (index_in_frequency_list == IS_NOT_ON_LIST)
   {
     MarkovNodeFrequency *temp =
         realloc (first_node->frequency_list,(first_node->frequency_list_size
@@ -147,27 +464,52 @@ int add_node_to_frequency_list(MarkovNode *first_node
     {
       return 1;
     }
-    // In case it allocation went successfully
-    else
+
+    // Change the pointer to the array to the new one
+    first_node->frequency_list = temp;
+    if (reserve_successor_index (first_node,
+                                 first_node->frequency_list_size + 1))
     {
+      return 1;
+    }
+    first_node->frequency_list_size+=1;
+    index_in_frequency_list = first_node->frequency_list_size - 1;
 
-      // Change the pointer to the array to the new one
-      first_node->frequency_list = temp;
-      first_node->frequency_list_size+=1;
+    // Initialing the last element to be the second node
+    first_node->frequency_list[index_in_frequency_list] =
+        (MarkovNodeFrequency) {second_node, 0};
+    index_successor (first_node, index_in_frequency_list);
+  }
 
-      // Initialing the last element to be the second node
-      first_node->frequency_list[first_node->frequency_list_size-1]
-      .markov_node = second_node;
+  // Increase the frequency, and move it ahead of the lower frequencies
+  MarkovNodeFrequency *list = first_node->frequency_list;
+  list[index_in_frequency_list].frequency += frequency;
+  int new_index = first_index_below_frequency
+      (list, index_in_frequency_list,
+       list[index_in_frequency_list].frequency);
+  if (new_index < index_in_frequency_list)
+  {
+    move_frequency_forward (first_node, index_in_frequency_list, new_index);
+  }
 
-      // Initialing frequency to 1
-      first_node->frequency_list[first_node->frequency_list_size-1]
-          .frequency = 1;
+  // Increase the total frequencies
+  first_node->total_of_frequency += frequency;
+  return 0;
+}
 
-      // Increase the total frequencies in 1
-      first_node->total_of_frequency+=1;
-      return 0;
-    }
-  }
+/**
+ * Add the second markov_node to the frequency list of the first markov_node.
+ * If already in list, update it's occurrence frequency value.
+ * @param first_node
+ * @param second_node
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+
+int add_node_to_frequency_list(MarkovNode *first_node
+    , MarkovNode *second_node)
+{
+  return add_frequency_to_list (first_node, second_node, 1);
 }
 
 /**
@@ -186,9 +528,9 @@ void free_database(MarkovChain ** ptr_chain)
       // Keep yhe value of the next node we want to delete
       next_node_to_free = node_to_free->next;
       // Free the word
-      if(node_to_free->data->data)
+      if(node_to_free->data->data && (*ptr_chain)->free_data)
       {
-        free (node_to_free->data->data);
+        (*ptr_chain)->free_data (node_to_free->data->data);
         node_to_free->data->data = NULL;
       }
       if(node_to_free->data->frequency_list)
@@ -197,6 +539,8 @@ void free_database(MarkovChain ** ptr_chain)
         free(node_to_free->data->frequency_list);
         node_to_free->data->frequency_list = NULL;
       }
+      // Free the successor index
+      free (node_to_free->data->successor_index);
       if(node_to_free->data)
       {
         // Free the markovnode
@@ -210,6 +554,9 @@ void free_database(MarkovChain ** ptr_chain)
       node_to_free = next_node_to_free;
     }
   }
+  // Free the hash index
+  free ((*ptr_chain)->index);
+  (*ptr_chain)->index = NULL;
   // Free the linked list
   if((*ptr_chain)->database)
   {
@@ -224,6 +571,142 @@ void free_database(MarkovChain ** ptr_chain)
   }
 }
 
+/**
+ * @brief A node of a chain being copied and its position in the database.
+ */
+typedef struct NodePosition
+{
+    MarkovNode *markov_node;
+    int position;
+} NodePosition;
+
+static int compare_node_positions(const void *first, const void *second)
+{
+  uintptr_t first_node = (uintptr_t) ((const NodePosition *) first)
+      ->markov_node;
+  uintptr_t second_node = (uintptr_t) ((const NodePosition *) second)
+      ->markov_node;
+  return (first_node > second_node) - (first_node < second_node);
+}
+
+/**
+ * Copy the frequency lists of markov_chain into copy, whose database holds
+ * the copies of the same data in the same order. Successors are mapped to
+ * their copies by position, through the source nodes sorted by address.
+ * @return 0 on success, 1 in case of allocation error
+ */
+static int copy_frequency_lists(MarkovChain *markov_chain,
+                                MarkovChain *copy)
+{
+  int size = markov_chain->database->size;
+  if (size == 0)
+  {
+    return 0;
+  }
+  NodePosition *positions = malloc (size * sizeof (NodePosition));
+  MarkovNode **copies = malloc (size * sizeof (MarkovNode *));
+  if (positions == NULL || copies == NULL)
+  {
+    free (positions);
+    free (copies);
+    return 1;
+  }
+  int position = 0;
+  Node *node = markov_chain->database->first;
+  for (Node *copy_node = copy->database->first; node != NULL;
+       node = node->next, copy_node = copy_node->next, position++)
+  {
+    positions[position] = (NodePosition) {node->data, position};
+    copies[position] = copy_node->data;
+  }
+  qsort (positions, size, sizeof (NodePosition), compare_node_positions);
+
+  int result = 0;
+  position = 0;
+  for (node = markov_chain->database->first; node != NULL && result == 0;
+       node = node->next, position++)
+  {
+    MarkovNode *source = node->data;
+    MarkovNode *target = copies[position];
+    if (source->frequency_list_size == 0)
+    {
+      continue;
+    }
+    target->frequency_list = malloc (source->frequency_list_size
+                                     * sizeof (MarkovNodeFrequency));
+    if (target->frequency_list == NULL)
+    {
+      result = 1;
+      continue;
+    }
+    for (int i = 0; i < source->frequency_list_size; i++)
+    {
+      NodePosition key = {source->frequency_list[i].markov_node, 0};
+      NodePosition *successor = bsearch (&key, positions, size,
+                                         sizeof (NodePosition),
+                                         compare_node_positions);
+      target->frequency_list[i] = (MarkovNodeFrequency)
+          {copies[successor->position], source->frequency_list[i].frequency};
+    }
+    target->frequency_list_size = source->frequency_list_size;
+    target->total_of_frequency = source->total_of_frequency;
+    result = index_frequency_list (target);
+  }
+  free (positions);
+  free (copies);
+  return result;
+}
+
+MarkovChain *copy_markov_chain(MarkovChain *markov_chain)
+{
+  // Both chains would own, and free, the same data
+  if (markov_chain->copy_func == NULL && markov_chain->free_data != NULL)
+  {
+    return NULL;
+  }
+  MarkovChain *copy = new_markov_chain (markov_chain->print_func,
+                                        markov_chain->comp_func,
+                                        markov_chain->free_data,
+                                        markov_chain->copy_func,
+                                        markov_chain->is_last,
+                                        markov_chain->hash_func);
+  if (copy == NULL)
+  {
+    return NULL;
+  }
+  // Copy the data first, so every successor has a node to point to. The
+  // data of a database is unique, no need to look it up
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next)
+  {
+    void *data = node->data->data;
+    if (copy->copy_func != NULL)
+    {
+      data = copy->copy_func (data);
+      if (data == NULL)
+      {
+        free_database (&copy);
+        return NULL;
+      }
+    }
+    if (add_new_node (copy, data) == NULL)
+    {
+      if (data != node->data->data && copy->free_data != NULL)
+      {
+        copy->free_data (data);
+      }
+      free_database (&copy);
+      return NULL;
+    }
+  }
+  if (copy_frequency_lists (markov_chain, copy))
+  {
+    free_database (&copy);
+    return NULL;
+  }
+  return copy;
+}
+
 /**
  *
  * @param markov_chain - pointer to database
@@ -243,21 +726,52 @@ MarkovNode* get_node_by_index(MarkovChain *markov_chain, int index)
   return temp->data;
 }
 
+/**
+ * Check if the given data ends a sequence in the chain.
+ * @param markov_chain - the chain the data belongs to
+ * @param data - given data
+ * @return true if the data is last in a sequence, false otherwise
+ */
+static bool is_end_of_sequence(MarkovChain *markov_chain, void *data)
+{
+  return markov_chain->is_last != NULL && markov_chain->is_last (data);
+}
+
 MarkovNode* get_first_random_node(MarkovChain *markov_chain)
+{
+  return get_first_random_node_r (markov_chain, NULL);
+}
+
+MarkovNode* get_first_random_node_r(MarkovChain *markov_chain,
+                                    unsigned long long *random_state)
 {
   int i = 0;
   int flag = 1;
-  int size_of_word = 0;
+  Node *temp;
 
   MarkovNode  *random_word = NULL;
+
+  // Make sure there is at least one word that can start a sentence,
+  // otherwise the random draw below would never end
+  for (temp = markov_chain->database->first; temp != NULL; temp = temp->next)
+  {
+    if (!is_end_of_sequence (markov_chain, temp->data->data))
+    {
+      break;
+    }
+  }
+  if (temp == NULL)
+  {
+    return NULL;
+  }
+
   while(flag)
   {
     // Get random number
-    i = get_random_number (markov_chain->database->size);
+    i = get_random_number_r (markov_chain->database->size, random_state);
 
     random_word = (get_node_by_index (markov_chain,i));
-    size_of_word = strlen (random_word->data);
-    if(random_word->data[size_of_word-1] != '.')
+    if(!is_end_of_sequence (markov_chain, random_word->data))
     {
       flag = 0;
     }
@@ -266,6 +780,12 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain)
 }
 
 MarkovNode* get_next_random_node(MarkovNode *cur_markov_node)
+{
+  return get_next_random_node_r (cur_markov_node, NULL);
+}
+
+MarkovNode* get_next_random_node_r(MarkovNode *cur_markov_node,
+                                   unsigned long long *random_state)
 {
   int i = 0;
   int max_number = 0;
@@ -273,7 +793,13 @@ MarkovNode* get_next_random_node(MarkovNode *cur_markov_node)
 
   max_number = cur_markov_node->total_of_frequency;
 
-  i = get_random_number (max_number);
+  // In case the word was never followed by another word
+  if (max_number <= 0)
+  {
+    return NULL;
+  }
+
+  i = get_random_number_r (max_number, random_state);
 
   for (int j = 0; j < cur_markov_node->frequency_list_size; j++)
   {
@@ -290,6 +816,37 @@ MarkovNode* get_next_random_node(MarkovNode *cur_markov_node)
   return NULL;
 }
 
+void generate_tweet(MarkovChain *markov_chain, MarkovNode *first_node,
+                    int max_length)
+{
+  generate_tweet_r (markov_chain, first_node, max_length, NULL);
+}
+
+void generate_tweet_r(MarkovChain *markov_chain, MarkovNode *first_node,
+                      int max_length, unsigned long long *random_state)
+{
+  int i = 1;
+  MarkovNode *current_random = first_node;
+
+  // Print the first random data
+  markov_chain->print_func (current_random->data);
+
+  // get random nodes as long as the node is not last or max length reached
+  while (i < max_length
+         && !is_end_of_sequence (markov_chain, current_random->data))
+  {
+    // get the next random node
+    current_random = get_next_random_node_r (current_random, random_state);
+    // In case the data was never followed by another data
+    if (current_random == NULL)
+    {
+      break;
+    }
+    markov_chain->print_func (current_random->data);
+    i++;
+  }
+}
+
 /**
  * Get random number between 0 and max_number [0, max_number).
  * @param max_number
@@ -300,4 +857,17 @@ int get_random_number(int max_number)
     return rand() % max_number;
 }
 
+int get_random_number_r(int max_number, unsigned long long *random_state)
+{
+  if (random_state == NULL)
+  {
+    return get_random_number (max_number);
+  }
+  unsigned long long z = (*random_state += SPLITMIX_INCREMENT);
+  z = (z ^ (z >> 30)) * SPLITMIX_FIRST_MULTIPLIER;
+  z = (z ^ (z >> 27)) * SPLITMIX_SECOND_MULTIPLIER;
+  z ^= z >> 31;
+  return (int) (z % (unsigned long long) max_number);
+}
+
 
@@ -5,36 +5,77 @@
 #include <stdio.h>  // For printf(), sscanf()
 #include <stdlib.h> // For malloc()
 #include <stdbool.h> // for bool
+#include <stddef.h> // for size_t
 
 #define ALLOCATION_ERROR_MASSAGE "Allocation failure: Failed to allocate"\
             "new memory\n"
 
+/**
+ * Callbacks describing the type of data (token) the chain is built of.
+ */
+// Print the data, followed by a separator if it is not the last in a sequence
+typedef void (*print_func)(void *data);
+// Compare two data, return 0 if equal (like strcmp)
+typedef int (*comp_func)(void *first, void *second);
+// Free data created by copy_func
+typedef void (*free_data)(void *data);
+// Return a dynamically allocated copy of the data, NULL on failure
+typedef void *(*copy_func)(void *data);
+// Return true if the data ends a sequence
+typedef bool (*is_last)(void *data);
+// Hash the data, equal data must have equal hashes
+typedef size_t (*hash_func)(void *data);
+
 /**
  * @brief Represents a Markov chain with a database of linked list nodes.
  *
  * @struct MarkovChain
  * @field database Pointer to a LinkedList representing the Markov chain's database.
+ * @field print_func Prints one data of the chain.
+ * @field comp_func Compares two data of the chain.
+ * @field free_data Frees a data of the chain, NULL if data is not owned.
+ * @field copy_func Copies a data into the chain, NULL to store the data
+ *        pointer itself (e.g. integer ids packed into the pointer).
+ * @field is_last Tells if a data ends a sequence, NULL if none does.
+ * @field hash_func Hashes a data, NULL to look data up by a linear scan.
+ * @field index Open addressing hash table of the database nodes.
+ * @field index_capacity Number of slots in index (a power of 2, or 0).
  */
 typedef struct MarkovChain
 {
     LinkedList *database;
+    print_func print_func;
+    comp_func comp_func;
+    free_data free_data;
+    copy_func copy_func;
+    is_last is_last;
+    hash_func hash_func;
+    Node **index;
+    int index_capacity;
 } MarkovChain;
 
 /**
  * @brief Represents a node in a Markov chain, holding data and frequency information.
  *
  * @struct MarkovNode
- * @field data A pointer to a string containing the node's data.
- * @field frequency_list A pointer to a list of frequencies associated with the node.
+ * @field data A pointer to the node's data.
+ * @field frequency_list A pointer to a list of frequencies associated with the node,
+ *        sorted by descending frequency.
  * @field total_of_frequency Total frequency count for the node.
  * @field frequency_list_size Size of the frequency_list.
+ * @field successor_index Open addressing hash table of the positions in
+ *        frequency_list plus one (0 for an empty slot), looked up by the
+ *        successor at the position. NULL for short lists.
+ * @field successor_index_capacity Number of slots in successor_index.
  */
 typedef struct MarkovNode
 {
-    char *data;
+    void *data;
     struct MarkovNodeFrequency* frequency_list;
     int total_of_frequency;
     int frequency_list_size;
+    unsigned int *successor_index;
+    int successor_index_capacity;
     // any other field you need
 } MarkovNode;
 
@@ -54,6 +95,15 @@ typedef struct MarkovNodeFrequency
 } MarkovNodeFrequency;
 
 
+/**
+ * Create an empty markov_chain over data of the type described by the given
+ * callbacks.
+ * @return the new markov_chain, NULL in case of memory allocation failure.
+ */
+MarkovChain *new_markov_chain(print_func print_func, comp_func comp_func,
+                              free_data free_data, copy_func copy_func,
+                              is_last is_last, hash_func hash_func);
+
 /**
 * Check if data_ptr is in database. If so, return the Node wrapping it in
  * the markov_chain, otherwise return NULL.
@@ -62,7 +112,7 @@ typedef struct MarkovNodeFrequency
  * @return Pointer to the Node wrapping given data, NULL if state not in
  * database.
  */
-Node* get_node_from_database(MarkovChain *markov_chain, char *data_ptr);
+Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr);
 
 /**
 * If data_ptr in markov_chain, return it's node. Otherwise, create new
@@ -72,12 +122,25 @@ Node* get_node_from_database(MarkovChain *markov_chain, char *data_ptr);
  * @return Node wrapping given data_ptr in given chain's database,
  * returns NULL in case of memory allocation failure.
  */
-Node* add_to_database(MarkovChain *markov_chain, char *data_ptr);
+Node* add_to_database(MarkovChain *markov_chain, void *data_ptr);
+
+/**
+ * Like add_to_database, but a new node stores data itself instead of a
+ * copy, and the chain frees it with free_data. If equal data is already in
+ * the database, its node is returned and data is left to the caller (check
+ * if the returned node's data is data).
+ * @param markov_chain the chain to look in its database
+ * @param data the data to look for
+ * @return Node wrapping equal data in given chain's database,
+ * returns NULL in case of memory allocation failure.
+ */
+Node* add_data_to_database(MarkovChain *markov_chain, void *data);
 
 
 /**
  * Add the second markov_node to the frequency list of the first markov_node.
- * If already in list, update it's occurrence frequency value.
+ * If already in list, update it's occurrence frequency value. The list is
+ * kept sorted by descending frequency.
  * @param first_node
  * @param second_node
  * @return success/failure: 0 if the process was successful, 1 if in
@@ -86,33 +149,113 @@ Node* add_to_database(MarkovChain *markov_chain, char *data_ptr);
 int add_node_to_frequency_list(MarkovNode *first_node
                                , MarkovNode *second_node);
 
+/**
+ * Find the second markov_node in the frequency list of the first
+ * markov_node.
+ * @param first_node
+ * @param second_node
+ * @return the entry of second_node in the list, NULL if first_node was never
+ * followed by second_node.
+ */
+MarkovNodeFrequency *get_node_from_frequency_list(MarkovNode *first_node,
+                                                  MarkovNode *second_node);
+
+/**
+ * Rebuild the successor index of markov_node, after its frequency_list was
+ * set directly instead of through add_frequency_to_list.
+ * @param markov_node
+ * @return 0 in case of success, 1 in case of allocation error.
+ */
+int index_frequency_list(MarkovNode *markov_node);
+
+/**
+ * Like add_node_to_frequency_list, but counts the second markov_node
+ * frequency times at once.
+ * @param first_node
+ * @param second_node
+ * @param frequency number of occurrences to add, positive
+ * @return success/failure: 0 if the process was successful, 1 in case of
+ * allocation error or if the total frequency would overflow.
+ */
+int add_frequency_to_list(MarkovNode *first_node, MarkovNode *second_node,
+                          int frequency);
+
 /**
  * Free markov_chain and all of it's content from memory
  * @param markov_chain markov_chain to free
  */
 void free_database(MarkovChain ** ptr_chain);
 
+/**
+ * Create a deep copy of markov_chain, with the same callbacks, data and
+ * frequencies. Used to build the next version of a chain while the
+ * current one is being read. A chain that frees data it does not copy
+ * (free_data without copy_func) cannot be copied, since both chains would
+ * free the same data.
+ * @param markov_chain markov_chain to copy
+ * @return the copy, NULL in case of memory allocation failure or if the
+ * chain cannot be copied.
+ */
+MarkovChain *copy_markov_chain(MarkovChain *markov_chain);
+
 /**
  * Get one random MarkovNode from the given markov_chain's database.
  * @param markov_chain
- * @return the random MarkovNode
+ * @return the random MarkovNode, NULL if no data in the database can start
+ * a sequence (the database is empty or every data is last).
  */
 MarkovNode* get_first_random_node(MarkovChain *markov_chain);
 
+/**
+ * Like get_first_random_node, but draws from the caller's random state
+ * instead of rand(), so concurrent readers do not share (and lock) it.
+ * @param markov_chain
+ * @param random_state the caller's state, see get_random_number_r
+ * @return the random MarkovNode, NULL if no data in the database can start
+ * a sequence.
+ */
+MarkovNode* get_first_random_node_r(MarkovChain *markov_chain,
+                                    unsigned long long *random_state);
+
 /**
  * Choose randomly the next MarkovNode, depend on it's occurrence frequency.
  * @param cur_markov_node current MarkovNode
- * @return the next random MarkovNode
+ * @return the next random MarkovNode, NULL if cur_markov_node has no
+ * successors.
  */
 MarkovNode* get_next_random_node(MarkovNode *cur_markov_node);
 
+/**
+ * Like get_next_random_node, but draws from the caller's random state
+ * instead of rand().
+ * @param cur_markov_node current MarkovNode
+ * @param random_state the caller's state, see get_random_number_r
+ * @return the next random MarkovNode, NULL if cur_markov_node has no
+ * successors.
+ */
+MarkovNode* get_next_random_node_r(MarkovNode *cur_markov_node,
+                                   unsigned long long *random_state);
+
 /**
  * Receive markov_chain, generate and print random sentence out of it. The
  * sentence must have at least 2 words in it.
+ * @param markov_chain the chain the nodes belong to
  * @param first_node markov_node to start with
  * @param  max_length maximum length of chain to generate
  */
-void generate_tweet(MarkovNode *first_node, int max_length);
+void generate_tweet(MarkovChain *markov_chain, MarkovNode *first_node,
+                    int max_length);
+
+/**
+ * Like generate_tweet, but draws from the caller's random state instead of
+ * rand().
+ * @param markov_chain the chain the nodes belong to
+ * @param first_node markov_node to start with
+ * @param max_length maximum length of chain to generate
+ * @param random_state the caller's state, see get_random_number_r
+ */
+void generate_tweet_r(MarkovChain *markov_chain, MarkovNode *first_node,
+                      int max_length, unsigned long long *random_state);
 
 /**
  * Get random number between 0 and max_number [0, max_number).
@@ -120,4 +263,15 @@ void generate_tweet(MarkovNode *first_node, int max_length);
  * @return Random number
  */
 int get_random_number(int max_number);
+
+/**
+ * Get random number between 0 and max_number [0, max_number), from the
+ * given state instead of rand()'s. Each thread keeps its own state, seeded
+ * with any value (splitmix64).
+ * @param max_number
+ * @param random_state the state to draw from and advance, NULL to use
+ * rand()
+ * @return Random number
+ */
+int get_random_number_r(int max_number, unsigned long long *random_state);
 #endif /* _MARKOV_CHAIN_H_ */
@@ -0,0 +1,84 @@
+#include "markov_publish_ex3a.h"
+#include <sched.h>
+
+MarkovPublisher *new_markov_publisher(MarkovChain *markov_chain)
+{
+  MarkovPublisher *publisher = malloc (sizeof (*publisher));
+  if (publisher == NULL)
+  {
+    return NULL;
+  }
+  if (pthread_mutex_init (&publisher->writer_lock, NULL) != 0)
+  {
+    free (publisher);
+    return NULL;
+  }
+  atomic_init (&publisher->current, markov_chain);
+  atomic_init (&publisher->epoch, 0);
+  for (int i = 0; i < READ_SLOTS; i++)
+  {
+    atomic_init (&publisher->readers[i], 0);
+  }
+  return publisher;
+}
+
+MarkovChain *read_lock_markov_chain(MarkovPublisher *publisher,
+                                    int *read_slot)
+{
+  unsigned long epoch;
+  while (1)
+  {
+    epoch = atomic_load (&publisher->epoch);
+    atomic_fetch_add (&publisher->readers[epoch % READ_SLOTS], 1);
+    // The registration only counts if no publish flipped the epoch before
+    // it, otherwise that publisher may already have stopped waiting on it
+    if (atomic_load (&publisher->epoch) == epoch)
+    {
+      break;
+    }
+    atomic_fetch_sub (&publisher->readers[epoch % READ_SLOTS], 1);
+  }
+  *read_slot = (int) (epoch % READ_SLOTS);
+  return atomic_load (&publisher->current);
+}
+
+void read_unlock_markov_chain(MarkovPublisher *publisher, int read_slot)
+{
+  atomic_fetch_sub (&publisher->readers[read_slot], 1);
+}
+
+void publish_markov_chain(MarkovPublisher *publisher,
+                          MarkovChain *markov_chain)
+{
+  pthread_mutex_lock (&publisher->writer_lock);
+
+  MarkovChain *old_chain = atomic_exchange (&publisher->current,
+                                            markov_chain);
+  // Readers registered from now on may only see the new version
+  unsigned long old_epoch = atomic_fetch_add (&publisher->epoch, 1);
+
+  // Wait for the readers that may still use the old version
+  while (atomic_load (&publisher->readers[old_epoch % READ_SLOTS]) != 0)
+  {
+    sched_yield ();
+  }
+
+  pthread_mutex_unlock (&publisher->writer_lock);
+
+  if (old_chain != NULL)
+  {
+    free_database (&old_chain);
+  }
+}
+
+void free_markov_publisher(MarkovPublisher **ptr_publisher)
+{
+  MarkovChain *markov_chain = atomic_load (&(*ptr_publisher)->current);
+  if (markov_chain != NULL)
+  {
+    free_database (&markov_chain);
+  }
+  pthread_mutex_destroy (&(*ptr_publisher)->writer_lock);
+  free (*ptr_publisher);
+  *ptr_publisher = NULL;
+}
@@ -0,0 +1,79 @@
+#ifndef _MARKOV_PUBLISH_H_
+#define _MARKOV_PUBLISH_H_
+
+#include "markov_chain_ex3a.h"
+#include <pthread.h> // For pthread_mutex_t
+#include <stdatomic.h> // For atomics
+
+#define READ_SLOTS 2
+
+/**
+ * @brief Publishes immutable versions of a markov_chain to concurrent
+ * readers.
+ *
+ * Readers generate from the current version without taking locks. A
+ * writer builds the next version on its own (for example from
+ * copy_markov_chain of the current one), then publishes it. The previous
+ * version is freed once every reader that could have seen it is done.
+ *
+ * @struct MarkovPublisher
+ * @field current The published version.
+ * @field epoch Incremented on every publish, its parity selects the
+ *        readers counter new readers register in.
+ * @field readers Number of active readers registered in each parity.
+ * @field writer_lock Serializes publishers.
+ */
+typedef struct MarkovPublisher
+{
+    _Atomic (MarkovChain *) current;
+    atomic_ulong epoch;
+    atomic_long readers[READ_SLOTS];
+    pthread_mutex_t writer_lock;
+} MarkovPublisher;
+
+/**
+ * Create a publisher serving the given markov_chain.
+ * @param markov_chain first version to serve, owned by the publisher from
+ * now on
+ * @return the new publisher, NULL in case of memory allocation failure.
+ */
+MarkovPublisher *new_markov_publisher(MarkovChain *markov_chain);
+
+/**
+ * Start reading the published markov_chain. Never blocks. The returned
+ * chain must not be modified, and stays valid until read_unlock_markov_chain
+ * is called with the same read_slot. Readers generating from it should use
+ * get_first_random_node_r, get_next_random_node_r and generate_tweet_r with
+ * a state of their own, rand() takes a lock shared by all the threads.
+ * @param publisher
+ * @param read_slot where to store the slot to pass to
+ * read_unlock_markov_chain
+ * @return the published markov_chain
+ */
+MarkovChain *read_lock_markov_chain(MarkovPublisher *publisher,
+                                    int *read_slot);
+
+/**
+ * Stop reading the markov_chain returned by read_lock_markov_chain.
+ * @param publisher
+ * @param read_slot the slot read_lock_markov_chain returned
+ */
+void read_unlock_markov_chain(MarkovPublisher *publisher, int read_slot);
+
+/**
+ * Replace the published markov_chain with a new version. Waits until no
+ * reader uses the previous version and frees it.
+ * @param publisher
+ * @param markov_chain the new version, owned by the publisher from now on
+ */
+void publish_markov_chain(MarkovPublisher *publisher,
+                          MarkovChain *markov_chain);
+
+/**
+ * Free the publisher and the published markov_chain. There must be no
+ * active readers.
+ * @param ptr_publisher publisher to free
+ */
+void free_markov_publisher(MarkovPublisher **ptr_publisher);
+
+#endif /* _MARKOV_PUBLISH_H_ */
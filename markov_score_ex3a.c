@@ -0,0 +1,70 @@
+#include "markov_score_ex3a.h"
+#include <math.h>
+
+/**
+ * Log-probability of moving from one node to another.
+ * @param from - given node
+ * @param to - given successor
+ * @return log(P(to | from)), -INFINITY if from was never followed by to
+ */
+static double transition_log_probability(MarkovNode *from, MarkovNode *to)
+{
+  MarkovNodeFrequency *transition = get_node_from_frequency_list (from, to);
+  if (transition == NULL)
+  {
+    return -INFINITY;
+  }
+  return log ((double) transition->frequency / from->total_of_frequency);
+}
+
+double score_sequence(MarkovChain *markov_chain, void **sequence,
+                      int length)
+{
+  double score = 0;
+  if (length <= 0)
+  {
+    return score;
+  }
+  Node *previous = get_node_from_database (markov_chain, sequence[0]);
+  if (previous == NULL)
+  {
+    return -INFINITY;
+  }
+  for (int i = 1; i < length; i++)
+  {
+    // Each data is looked up once, as the target and then as the source
+    Node *current = get_node_from_database (markov_chain, sequence[i]);
+    if (current == NULL)
+    {
+      return -INFINITY;
+    }
+    score += transition_log_probability (previous->data, current->data);
+    if (score == -INFINITY)
+    {
+      return score;
+    }
+    previous = current;
+  }
+  return score;
+}
+
+void score_sequences(MarkovChain *markov_chain, void ***sequences,
+                     const int *lengths, int num_of_sequences,
+                     double *scores)
+{
+  for (int i = 0; i < num_of_sequences; i++)
+  {
+    scores[i] = score_sequence (markov_chain, sequences[i], lengths[i]);
+  }
+}
+
+int get_top_successors(MarkovNode *markov_node, int k,
+                       MarkovNodeFrequency **successors)
+{
+  *successors = markov_node->frequency_list;
+  if (k > markov_node->frequency_list_size)
+  {
+    k = markov_node->frequency_list_size;
+  }
+  return k < 0 ? 0 : k;
+}
@@ -0,0 +1,45 @@
+#ifndef _MARKOV_SCORE_H_
+#define _MARKOV_SCORE_H_
+
+#include "markov_chain_ex3a.h"
+
+/**
+ * Log-likelihood of a sequence under markov_chain: the sum of
+ * log(P(sequence[i + 1] | sequence[i])) over all its transitions. The first
+ * data is given, so an empty sequence, or one of a single data in the
+ * chain, scores 0.
+ * @param markov_chain the chain to score with
+ * @param sequence the data of the sequence, in order
+ * @param length number of data in sequence
+ * @return the log-likelihood (natural log), -INFINITY if the sequence has
+ * data missing from the chain or a transition the chain never saw.
+ */
+double score_sequence(MarkovChain *markov_chain, void **sequence,
+                      int length);
+
+/**
+ * Score many sequences in one call, see score_sequence.
+ * @param markov_chain the chain to score with
+ * @param sequences sequences to score
+ * @param lengths number of data in each sequence
+ * @param num_of_sequences number of sequences
+ * @param scores where to store the log-likelihood of each sequence
+ */
+void score_sequences(MarkovChain *markov_chain, void ***sequences,
+                     const int *lengths, int num_of_sequences,
+                     double *scores);
+
+/**
+ * Get the k most likely successors of markov_node. Takes O(1), the
+ * successors are not copied.
+ * @param markov_node the node whose successors to get
+ * @param k maximum number of successors to get
+ * @param successors where to store a pointer to the successors, in
+ * descending frequency. The probability of each is its frequency divided
+ * by markov_node->total_of_frequency.
+ * @return number of successors stored, at most k
+ */
+int get_top_successors(MarkovNode *markov_node, int k,
+                       MarkovNodeFrequency **successors);
+
+#endif /* _MARKOV_SCORE_H_ */
@@ -0,0 +1,761 @@
+#include "markov_snapshot_ex3a.h"
+#include "markov_bytes_ex3a.h"
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC "MKCZ"
+#define SNAPSHOT_MAGIC_SIZE 4
+#define SNAPSHOT_VERSION 2
+#define NODES_PER_BLOCK 1024
+#define INITIAL_BUFFER_CAPACITY 4096
+#define READ_CHUNK_SIZE 65536
+
+/**
+ * @brief A growable array of bytes.
+ */
+typedef struct ByteBuffer
+{
+    unsigned char *bytes;
+    size_t size;
+    size_t capacity;
+} ByteBuffer;
+
+/**
+ * @brief A node of the chain with its serialized data and its position in
+ * the database.
+ */
+typedef struct SnapshotEntry
+{
+    MarkovNode *markov_node;
+    const unsigned char *bytes;
+    size_t size;
+    int position;
+} SnapshotEntry;
+
+/**
+ * @brief A node of the chain with its number in the snapshot.
+ */
+typedef struct NodeNumber
+{
+    MarkovNode *markov_node;
+    uint64_t number;
+} NodeNumber;
+
+/**
+ * @brief A successor of a node while it is being saved, with its position
+ * in the frequency list.
+ */
+typedef struct SnapshotSuccessor
+{
+    uint64_t number;
+    int frequency;
+    int position;
+} SnapshotSuccessor;
+
+/**
+ * @brief The frames of a snapshot being loaded.
+ */
+typedef struct SnapshotFrames
+{
+    const unsigned char **starts;
+    size_t *sizes;
+    uint64_t num_of_nodes;
+    uint64_t nodes_per_block;
+    int num_of_blocks;
+} SnapshotFrames;
+
+/**
+ * @brief The part of the frames one thread decodes.
+ */
+typedef struct DecodeWork
+{
+    SnapshotFrames *frames;
+    void **datas;
+    uint64_t *positions;
+    MarkovNode **nodes;
+    from_bytes_func from_bytes;
+    int (*decode_frame)(struct DecodeWork *work, int block);
+    int thread_index;
+    int num_of_threads;
+    int result;
+} DecodeWork;
+
+/**
+ * Make room for extra more bytes in the buffer.
+ * @return 0 in case of success, 1 in case of allocation error
+ */
+static int reserve_bytes(ByteBuffer *buffer, size_t extra)
+{
+  if (buffer->size + extra <= buffer->capacity)
+  {
+    return 0;
+  }
+  size_t new_capacity = buffer->capacity == 0 ? INITIAL_BUFFER_CAPACITY
+                                              : buffer->capacity;
+  while (new_capacity < buffer->size + extra)
+  {
+    new_capacity *= 2;
+  }
+  unsigned char *temp = realloc (buffer->bytes, new_capacity);
+  if (temp == NULL)
+  {
+    return 1;
+  }
+  buffer->bytes = temp;
+  buffer->capacity = new_capacity;
+  return 0;
+}
+
+/**
+ * Append bytes to the buffer.
+ * @return 0 in case of success, 1 in case of allocation error
+ */
+static int write_bytes(ByteBuffer *buffer, const unsigned char *bytes,
+                       size_t size)
+{
+  if (reserve_bytes (buffer, size))
+  {
+    return 1;
+  }
+  if (size > 0)
+  {
+    memcpy (buffer->bytes + buffer->size, bytes, size);
+  }
+  buffer->size += size;
+  return 0;
+}
+
+/**
+ * Append a varint to the buffer.
+ * @return 0 in case of success, 1 in case of allocation error
+ */
+static int write_varint(ByteBuffer *buffer, uint64_t value)
+{
+  unsigned char bytes[MAX_VARINT_SIZE];
+  return write_bytes (buffer, bytes, encode_varint (value, bytes));
+}
+
+/**
+ * Write the buffer to the file as a frame (its length, then its bytes).
+ * @return 0 in case of success, 1 otherwise
+ */
+static int write_frame(FILE *fp, ByteBuffer *frame)
+{
+  ByteBuffer length = {NULL, 0, 0};
+  if (write_varint (&length, frame->size))
+  {
+    return 1;
+  }
+  int result = fwrite (length.bytes, 1, length.size, fp) != length.size
+               || fwrite (frame->bytes, 1, frame->size, fp) != frame->size;
+  free (length.bytes);
+  return result;
+}
+
+static int compare_entries_by_bytes(const void *first, const void *second)
+{
+  const SnapshotEntry *first_entry = first;
+  const SnapshotEntry *second_entry = second;
+  size_t common = first_entry->size < second_entry->size ? first_entry->size
+                                                         : second_entry->size;
+  int result = common == 0 ? 0 : memcmp (first_entry->bytes,
+                                         second_entry->bytes, common);
+  if (result != 0)
+  {
+    return result;
+  }
+  return (first_entry->size > second_entry->size)
+         - (first_entry->size < second_entry->size);
+}
+
+static int compare_numbers_by_node(const void *first, const void *second)
+{
+  const MarkovNode *first_node = ((const NodeNumber *) first)->markov_node;
+  const MarkovNode *second_node = ((const NodeNumber *) second)->markov_node;
+  return (first_node > second_node) - (first_node < second_node);
+}
+
+static int compare_successors_by_number(const void *first, const void *second)
+{
+  uint64_t first_number = ((const SnapshotSuccessor *) first)->number;
+  uint64_t second_number = ((const SnapshotSuccessor *) second)->number;
+  return (first_number > second_number) - (first_number < second_number);
+}
+
+/**
+ * Get the number of markov_node in the snapshot.
+ * @param numbers - the numbers of all nodes, sorted by node address
+ */
+static uint64_t find_node_number(NodeNumber *numbers, int num_of_nodes,
+                                 MarkovNode *markov_node)
+{
+  NodeNumber key = {markov_node, 0};
+  NodeNumber *found = bsearch (&key, numbers, num_of_nodes,
+                               sizeof (NodeNumber), compare_numbers_by_node);
+  return found->number;
+}
+
+/**
+ * Front-code the data of one block of entries into frame, each followed by
+ * its position in the database.
+ * @return 0 in case of success, 1 in case of allocation error
+ */
+static int encode_vocabulary_frame(ByteBuffer *frame, SnapshotEntry *entries,
+                                   int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    size_t shared = 0;
+    if (i > 0)
+    {
+      while (shared < entries[i].size && shared < entries[i - 1].size
+             && entries[i].bytes[shared] == entries[i - 1].bytes[shared])
+      {
+        shared++;
+      }
+    }
+    if (write_varint (frame, shared)
+        || write_varint (frame, entries[i].size - shared)
+        || write_bytes (frame, entries[i].bytes + shared,
+                        entries[i].size - shared)
+        || write_varint (frame, entries[i].position))
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Delta-code the successors of one block of entries into frame, each
+ * followed by its frequency and its position in the frequency list.
+ * @return 0 in case of success, 1 in case of allocation error
+ */
+static int encode_successor_frame(ByteBuffer *frame, SnapshotEntry *entries,
+                                  int count, NodeNumber *numbers,
+                                  int num_of_nodes)
+{
+  for (int i = 0; i < count; i++)
+  {
+    MarkovNode *markov_node = entries[i].markov_node;
+    int size = markov_node->frequency_list_size;
+    if (write_varint (frame, size))
+    {
+      return 1;
+    }
+    if (size == 0)
+    {
+      continue;
+    }
+    SnapshotSuccessor *successors = malloc (size * sizeof (*successors));
+    if (successors == NULL)
+    {
+      return 1;
+    }
+    for (int j = 0; j < size; j++)
+    {
+      successors[j].number = find_node_number
+          (numbers, num_of_nodes,
+           markov_node->frequency_list[j].markov_node);
+      successors[j].frequency = markov_node->frequency_list[j].frequency;
+      successors[j].position = j;
+    }
+    qsort (successors, size, sizeof (*successors),
+           compare_successors_by_number);
+    uint64_t previous = 0;
+    for (int j = 0; j < size; j++)
+    {
+      if (write_varint (frame, successors[j].number - previous)
+          || write_varint (frame, successors[j].frequency)
+          || write_varint (frame, successors[j].position))
+      {
+        free (successors);
+        return 1;
+      }
+      previous = successors[j].number;
+    }
+    free (successors);
+  }
+  return 0;
+}
+
+/**
+ * Write the header and all frames of the snapshot.
+ * @param entries - the nodes of the chain, sorted by bytes
+ * @param numbers - the numbers of the nodes, sorted by node address
+ * @return 0 in case of success, 1 otherwise
+ */
+static int write_snapshot(FILE *fp, SnapshotEntry *entries,
+                          NodeNumber *numbers, int num_of_nodes)
+{
+  ByteBuffer frame = {NULL, 0, 0};
+  int result = write_bytes (&frame, (const unsigned char *) SNAPSHOT_MAGIC,
+                            SNAPSHOT_MAGIC_SIZE)
+               || write_varint (&frame, SNAPSHOT_VERSION)
+               || write_varint (&frame, num_of_nodes)
+               || write_varint (&frame, NODES_PER_BLOCK)
+               || fwrite (frame.bytes, 1, frame.size, fp) != frame.size;
+
+  // All vocabulary frames, then all successor frames
+  for (int pass = 0; pass < 2 && result == 0; pass++)
+  {
+    for (int first = 0; first < num_of_nodes && result == 0;
+         first += NODES_PER_BLOCK)
+    {
+      int count = num_of_nodes - first < NODES_PER_BLOCK
+                  ? num_of_nodes - first : NODES_PER_BLOCK;
+      frame.size = 0;
+      if (pass == 0)
+      {
+        result = encode_vocabulary_frame (&frame, entries + first, count);
+      }
+      else
+      {
+        result = encode_successor_frame (&frame, entries + first, count,
+                                         numbers, num_of_nodes);
+      }
+      result = result || write_frame (fp, &frame);
+    }
+  }
+  free (frame.bytes);
+  return result;
+}
+
+int save_database(FILE *fp, MarkovChain *markov_chain, to_bytes_func to_bytes)
+{
+  int num_of_nodes = markov_chain->database->size;
+  SnapshotEntry *entries = malloc ((num_of_nodes + 1) * sizeof (*entries));
+  NodeNumber *numbers = malloc ((num_of_nodes + 1) * sizeof (*numbers));
+  if (entries == NULL || numbers == NULL)
+  {
+    free (entries);
+    free (numbers);
+    return 1;
+  }
+
+  // Number the nodes in the byte order of their data
+  int i = 0;
+  for (Node *node = markov_chain->database->first; node != NULL;
+       node = node->next, i++)
+  {
+    entries[i].markov_node = node->data;
+    entries[i].bytes = to_bytes (node->data->data, &entries[i].size);
+    entries[i].position = i;
+  }
+  qsort (entries, num_of_nodes, sizeof (*entries), compare_entries_by_bytes);
+  for (i = 0; i < num_of_nodes; i++)
+  {
+    numbers[i] = (NodeNumber) {entries[i].markov_node, (uint64_t) i};
+  }
+  qsort (numbers, num_of_nodes, sizeof (*numbers), compare_numbers_by_node);
+
+  int result = write_snapshot (fp, entries, numbers, num_of_nodes);
+  free (entries);
+  free (numbers);
+  return result || fflush (fp) != 0;
+}
+
+/**
+ * Read the whole file into the buffer.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int read_file(FILE *fp, ByteBuffer *buffer)
+{
+  size_t read_size;
+  do
+  {
+    if (reserve_bytes (buffer, READ_CHUNK_SIZE))
+    {
+      return 1;
+    }
+    read_size = fread (buffer->bytes + buffer->size, 1, READ_CHUNK_SIZE, fp);
+    buffer->size += read_size;
+  }
+  while (read_size == READ_CHUNK_SIZE);
+  return ferror (fp) != 0;
+}
+
+/**
+ * Locate num_of_blocks frames starting at *pos, and move *pos past them.
+ * @return 0 in case of success, 1 if the frames are truncated
+ */
+static int locate_frames(const unsigned char **pos, const unsigned char *end,
+                         const unsigned char **starts, size_t *sizes,
+                         int num_of_blocks)
+{
+  for (int i = 0; i < num_of_blocks; i++)
+  {
+    uint64_t size;
+    if (decode_varint (pos, end, &size) || size > (uint64_t) (end - *pos))
+    {
+      return 1;
+    }
+    starts[i] = *pos;
+    sizes[i] = size;
+    *pos += size;
+  }
+  return 0;
+}
+
+/**
+ * Get the range of nodes of a block.
+ * @param first - where to store the number of the first node of the block
+ * @return number of nodes in the block
+ */
+static uint64_t block_nodes(SnapshotFrames *frames, int block,
+                            uint64_t *first)
+{
+  *first = (uint64_t) block * frames->nodes_per_block;
+  uint64_t left = frames->num_of_nodes - *first;
+  return left < frames->nodes_per_block ? left : frames->nodes_per_block;
+}
+
+/**
+ * Decode the data of the nodes of one vocabulary frame into work->datas,
+ * and their positions in the database into work->positions.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int decode_vocabulary_frame(DecodeWork *work, int block)
+{
+  SnapshotFrames *frames = work->frames;
+  const unsigned char *pos = frames->starts[block];
+  const unsigned char *end = pos + frames->sizes[block];
+  uint64_t first;
+  uint64_t count = block_nodes (frames, block, &first);
+  ByteBuffer key = {NULL, 0, 0};
+
+  for (uint64_t i = 0; i < count; i++)
+  {
+    uint64_t shared;
+    uint64_t suffix;
+    if (decode_varint (&pos, end, &shared) || shared > key.size
+        || decode_varint (&pos, end, &suffix)
+        || suffix > (uint64_t) (end - pos))
+    {
+      free (key.bytes);
+      return 1;
+    }
+    key.size = shared;
+    // Keep key.bytes allocated even for empty data
+    if (reserve_bytes (&key, suffix + 1) || write_bytes (&key, pos, suffix))
+    {
+      free (key.bytes);
+      return 1;
+    }
+    pos += suffix;
+    work->datas[first + i] = work->from_bytes (key.bytes, key.size);
+    if (work->datas[first + i] == NULL
+        || decode_varint (&pos, end, &work->positions[first + i])
+        || work->positions[first + i] >= frames->num_of_nodes)
+    {
+      free (key.bytes);
+      return 1;
+    }
+  }
+  free (key.bytes);
+  return pos != end;
+}
+
+/**
+ * Decode one successor list into markov_node, every successor at its saved
+ * position. The positions must make a list sorted by descending frequency.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int decode_successors(DecodeWork *work, const unsigned char **pos,
+                             const unsigned char *end,
+                             MarkovNode *markov_node)
+{
+  uint64_t size;
+  if (decode_varint (pos, end, &size) || size > work->frames->num_of_nodes)
+  {
+    return 1;
+  }
+  if (size == 0)
+  {
+    return 0;
+  }
+  // An empty entry has no node, each position is taken once
+  MarkovNodeFrequency *list = calloc (size, sizeof (*list));
+  if (list == NULL)
+  {
+    return 1;
+  }
+  uint64_t number = 0;
+  long long total = 0;
+  for (uint64_t j = 0; j < size; j++)
+  {
+    uint64_t delta;
+    uint64_t frequency;
+    uint64_t position;
+    // Numbers are strictly ascending, and frequencies positive
+    if (decode_varint (pos, end, &delta) || (j > 0 && delta == 0)
+        || delta >= work->frames->num_of_nodes - number
+        || decode_varint (pos, end, &frequency) || frequency == 0
+        || frequency > INT_MAX || (total += frequency) > INT_MAX
+        || decode_varint (pos, end, &position) || position >= size
+        || list[position].markov_node != NULL)
+    {
+      free (list);
+      return 1;
+    }
+    number += delta;
+    list[position] = (MarkovNodeFrequency) {work->nodes[number],
+                                            (int) frequency};
+  }
+  for (uint64_t j = 1; j < size; j++)
+  {
+    if (list[j - 1].frequency < list[j].frequency)
+    {
+      free (list);
+      return 1;
+    }
+  }
+  markov_node->frequency_list = list;
+  markov_node->frequency_list_size = (int) size;
+  markov_node->total_of_frequency = (int) total;
+  return index_frequency_list (markov_node);
+}
+
+/**
+ * Decode the successor lists of the nodes of one successor frame.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int decode_successor_frame(DecodeWork *work, int block)
+{
+  SnapshotFrames *frames = work->frames;
+  const unsigned char *pos = frames->starts[block];
+  const unsigned char *end = pos + frames->sizes[block];
+  uint64_t first;
+  uint64_t count = block_nodes (frames, block, &first);
+
+  for (uint64_t i = 0; i < count; i++)
+  {
+    if (decode_successors (work, &pos, end, work->nodes[first + i]))
+    {
+      return 1;
+    }
+  }
+  return pos != end;
+}
+
+/**
+ * Thread body: decode every num_of_threads-th frame.
+ */
+static void *decode_frames(void *arg)
+{
+  DecodeWork *work = arg;
+  for (int block = work->thread_index; block < work->frames->num_of_blocks;
+       block += work->num_of_threads)
+  {
+    if (work->decode_frame (work, block))
+    {
+      work->result = 1;
+      break;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Decode all frames with up to num_of_threads threads, the calling thread
+ * being one of them.
+ * @param work - the work of the first thread, copied for the others
+ * @return 0 in case of success, 1 otherwise
+ */
+static int decode_in_parallel(DecodeWork *work, int num_of_threads)
+{
+  if (num_of_threads > work->frames->num_of_blocks)
+  {
+    num_of_threads = work->frames->num_of_blocks;
+  }
+  if (num_of_threads <= 1)
+  {
+    work->thread_index = 0;
+    work->num_of_threads = 1;
+    decode_frames (work);
+    return work->result;
+  }
+
+  DecodeWork *works = malloc (num_of_threads * sizeof (*works));
+  pthread_t *threads = malloc (num_of_threads * sizeof (*threads));
+  bool *started = calloc (num_of_threads, sizeof (*started));
+  if (works == NULL || threads == NULL || started == NULL)
+  {
+    free (works);
+    free (threads);
+    free (started);
+    return 1;
+  }
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    works[i] = *work;
+    works[i].thread_index = i;
+    works[i].num_of_threads = num_of_threads;
+    works[i].result = 0;
+  }
+  for (int i = 1; i < num_of_threads; i++)
+  {
+    started[i] = pthread_create (&threads[i], NULL, decode_frames,
+                                 &works[i]) == 0;
+  }
+  decode_frames (&works[0]);
+
+  int result = 0;
+  for (int i = 0; i < num_of_threads; i++)
+  {
+    if (i > 0 && started[i])
+    {
+      pthread_join (threads[i], NULL);
+    }
+    else if (i > 0)
+    {
+      // Could not start a thread, do its part here
+      decode_frames (&works[i]);
+    }
+    result = result || works[i].result;
+  }
+  free (works);
+  free (threads);
+  free (started);
+  return result;
+}
+
+/**
+ * Add the decoded data to the chain at their saved positions. The data is
+ * owned by the chain from now on.
+ * @param positions - the position of each node, must be a permutation
+ * @param numbers - where to order the nodes by position
+ * @return 0 in case of success, 1 otherwise
+ */
+static int add_decoded_nodes(MarkovChain *markov_chain, void **datas,
+                             const uint64_t *positions, uint64_t *numbers,
+                             MarkovNode **nodes, uint64_t num_of_nodes)
+{
+  for (uint64_t i = 0; i < num_of_nodes; i++)
+  {
+    numbers[i] = num_of_nodes;
+  }
+  for (uint64_t i = 0; i < num_of_nodes; i++)
+  {
+    // Two nodes at the same position means the snapshot is corrupted
+    if (numbers[positions[i]] != num_of_nodes)
+    {
+      return 1;
+    }
+    numbers[positions[i]] = i;
+  }
+  for (uint64_t position = 0; position < num_of_nodes; position++)
+  {
+    uint64_t i = numbers[position];
+    Node *node = add_data_to_database (markov_chain, datas[i]);
+    // The same data twice means the snapshot is corrupted
+    if (node == NULL || node->data->data != datas[i])
+    {
+      return 1;
+    }
+    nodes[i] = node->data;
+    datas[i] = NULL;
+  }
+  return 0;
+}
+
+/**
+ * Parse the header and frames of the snapshot in buffer, and fill the
+ * chain from them.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int parse_snapshot(ByteBuffer *buffer, MarkovChain *markov_chain,
+                          from_bytes_func from_bytes, int num_of_threads)
+{
+  const unsigned char *pos = buffer->bytes;
+  const unsigned char *end = buffer->bytes + buffer->size;
+  uint64_t version;
+  SnapshotFrames frames = {NULL, NULL, 0, 0, 0};
+  if (buffer->size < SNAPSHOT_MAGIC_SIZE
+      || memcmp (pos, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) != 0)
+  {
+    return 1;
+  }
+  pos += SNAPSHOT_MAGIC_SIZE;
+  if (decode_varint (&pos, end, &version) || version != SNAPSHOT_VERSION
+      || decode_varint (&pos, end, &frames.num_of_nodes)
+      || frames.num_of_nodes > INT_MAX
+      || frames.num_of_nodes > buffer->size
+      || decode_varint (&pos, end, &frames.nodes_per_block)
+      || frames.nodes_per_block == 0)
+  {
+    return 1;
+  }
+  // Rounded up without overflowing, nodes_per_block is not trusted
+  uint64_t num_of_blocks = frames.num_of_nodes / frames.nodes_per_block
+      + (frames.num_of_nodes % frames.nodes_per_block != 0);
+  // There are 2 frames per block, numbered by int
+  if (num_of_blocks > INT_MAX / 2)
+  {
+    return 1;
+  }
+  frames.num_of_blocks = (int) num_of_blocks;
+
+  size_t num_of_frames = 2 * (size_t) frames.num_of_blocks + 1;
+  const unsigned char **starts = malloc (num_of_frames * sizeof (*starts));
+  size_t *sizes = malloc (num_of_frames * sizeof (*sizes));
+  void **datas = calloc (frames.num_of_nodes + 1, sizeof (*datas));
+  MarkovNode **nodes = malloc ((frames.num_of_nodes + 1) * sizeof (*nodes));
+  uint64_t *positions = malloc ((frames.num_of_nodes + 1)
+                                * sizeof (*positions));
+  uint64_t *numbers = malloc ((frames.num_of_nodes + 1) * sizeof (*numbers));
+  int result = starts == NULL || sizes == NULL || datas == NULL
+               || nodes == NULL || positions == NULL || numbers == NULL
+               || locate_frames (&pos, end, starts, sizes,
+                                 2 * frames.num_of_blocks)
+               || pos != end;
+
+  DecodeWork work = {&frames, datas, positions, nodes, from_bytes,
+                     decode_vocabulary_frame, 0, 1, 0};
+  if (result == 0)
+  {
+    // Vocabulary frames, then the nodes, then successor frames
+    frames.starts = starts;
+    frames.sizes = sizes;
+    result = decode_in_parallel (&work, num_of_threads)
+             || add_decoded_nodes (markov_chain, datas, positions, numbers,
+                                   nodes, frames.num_of_nodes);
+  }
+  if (result == 0)
+  {
+    frames.starts = starts + frames.num_of_blocks;
+    frames.sizes = sizes + frames.num_of_blocks;
+    work.decode_frame = decode_successor_frame;
+    work.result = 0;
+    result = decode_in_parallel (&work, num_of_threads);
+  }
+
+  // Free the data that did not make it into the chain
+  for (uint64_t i = 0; datas != NULL && i < frames.num_of_nodes; i++)
+  {
+    if (datas[i] != NULL && markov_chain->free_data != NULL)
+    {
+      markov_chain->free_data (datas[i]);
+    }
+  }
+  free (starts);
+  free (sizes);
+  free (datas);
+  free (nodes);
+  free (positions);
+  free (numbers);
+  return result;
+}
+
+int load_database(FILE *fp, MarkovChain *markov_chain,
+                  from_bytes_func from_bytes, int num_of_threads)
+{
+  ByteBuffer buffer = {NULL, 0, 0};
+  int result = read_file (fp, &buffer)
+               || parse_snapshot (&buffer, markov_chain, from_bytes,
+                                  num_of_threads);
+  free (buffer.bytes);
+  return result;
+}
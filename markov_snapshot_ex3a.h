@@ -0,0 +1,59 @@
+#ifndef _MARKOV_SNAPSHOT_H_
+#define _MARKOV_SNAPSHOT_H_
+
+#include "markov_chain_ex3a.h"
+
+/**
+ * Compressed snapshot format of a markov_chain (all integers are LEB128
+ * varints):
+ *
+ *   "MKCZ" version num_of_nodes nodes_per_block
+ *   vocabulary frames, one per block of nodes_per_block nodes
+ *   successor frames, one per block of nodes_per_block nodes
+ *
+ * Every frame is its byte length followed by its content, so frames can
+ * be located without decoding them and decoded independently. Nodes are
+ * numbered in the byte order of their data. A vocabulary frame front-codes
+ * the data of its nodes (shared prefix length with the previous data of
+ * the frame, suffix length, suffix), each followed by the position of the
+ * node in the database. A successor frame holds, for each of its nodes,
+ * the number of successors, then the delta-coded successor numbers in
+ * ascending order, each followed by its frequency and its position in the
+ * frequency list.
+ *
+ * The positions restore the database and every frequency list in their
+ * saved order, so a loaded chain generates the same tweets as the saved
+ * one for the same seed.
+ */
+
+// Return the bytes that represent data, and store their number in size
+typedef const unsigned char *(*to_bytes_func)(void *data, size_t *size);
+// Create data from the given bytes, owned by the chain, NULL on failure
+typedef void *(*from_bytes_func)(const unsigned char *bytes, size_t size);
+
+/**
+ * Write a compressed snapshot of markov_chain to the given file.
+ * @param fp - file to write to
+ * @param markov_chain - chain to save
+ * @param to_bytes - serializes the data of the chain. Different data must
+ * have different bytes.
+ * @return 0 in case of success, 1 otherwise
+ */
+int save_database(FILE *fp, MarkovChain *markov_chain, to_bytes_func to_bytes);
+
+/**
+ * Fill an empty markov_chain from a snapshot written by save_database.
+ * Frames are decoded by num_of_threads threads. In case of failure the
+ * chain may be partially filled, and should be freed with free_database.
+ * @param fp - file to read from
+ * @param markov_chain - empty chain to fill, created with the callbacks of
+ * the saved data type
+ * @param from_bytes - deserializes the data of the chain. The data it
+ * creates is stored as is (not through copy_func) and freed with free_data.
+ * @param num_of_threads - number of threads decoding frames (at least 1)
+ * @return 0 in case of success, 1 otherwise
+ */
+int load_database(FILE *fp, MarkovChain *markov_chain,
+                  from_bytes_func from_bytes, int num_of_threads);
+
+#endif /* _MARKOV_SNAPSHOT_H_ */
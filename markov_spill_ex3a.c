@@ -0,0 +1,772 @@
+#include "markov_spill_ex3a.h"
+#include "markov_bytes_ex3a.h"
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h> // For getrusage()
+
+#define NO_SECOND UINT32_MAX
+#define ENTRY_ALIGNMENT 8
+#define SLOTS_SHARE 4
+#define MIN_NUM_OF_SLOTS 16
+// A IO_BUFFER_SHARE of the memory goes to each file buffer, within bounds
+#define IO_BUFFER_SHARE 8
+#define MIN_IO_BUFFER_SIZE 512
+#define MAX_IO_BUFFER_SIZE (64 * 1024)
+// Buffers of the files a merge pass reads from and writes to
+#define MERGE_FILE_BUFFERS 2
+
+/**
+ * @brief A counted bigram in the arena, followed by the bytes of first
+ * and then of second.
+ */
+typedef struct BigramEntry
+{
+    uint64_t count;
+    uint32_t first_size;
+    uint32_t second_size;
+} BigramEntry;
+
+/**
+ * @brief A bigram being compared, hashed or merged.
+ */
+typedef struct BigramKey
+{
+    const unsigned char *first;
+    size_t first_size;
+    const unsigned char *second;
+    size_t second_size;
+} BigramKey;
+
+/**
+ * @brief The current record of one run during the merge. Runs share one
+ * file, each cursor reads its run through a buffer of its own.
+ */
+typedef struct RunCursor
+{
+    FILE *fp;
+    unsigned char *buffer;
+    size_t buffer_size;
+    size_t buffered;
+    size_t consumed;
+    long position;
+    long end;
+    unsigned char *bytes;
+    size_t capacity;
+    BigramKey key;
+    uint64_t count;
+} RunCursor;
+
+/**
+ * @brief Where merged bigrams go: to the runs of output if it is not NULL,
+ * otherwise to the chain, with the data a merged bigram starts with.
+ */
+typedef struct MergeState
+{
+    MarkovChain *markov_chain;
+    from_bytes_func from_bytes;
+    unsigned char *first;
+    size_t first_size;
+    MarkovNode *first_node;
+    FILE *output;
+    size_t output_size;
+} MergeState;
+
+static BigramKey entry_key(BigramEntry *entry)
+{
+  const unsigned char *bytes = (const unsigned char *) (entry + 1);
+  BigramKey key = {bytes, entry->first_size, NULL, 0};
+  if (entry->second_size != NO_SECOND)
+  {
+    key.second = bytes + entry->first_size;
+    key.second_size = entry->second_size;
+  }
+  return key;
+}
+
+static int compare_bytes(const unsigned char *first, size_t first_size,
+                         const unsigned char *second, size_t second_size)
+{
+  size_t common = first_size < second_size ? first_size : second_size;
+  int result = common == 0 ? 0 : memcmp (first, second, common);
+  if (result != 0)
+  {
+    return result;
+  }
+  return (first_size > second_size) - (first_size < second_size);
+}
+
+/**
+ * Order bigrams by first, then by second. A first counted without second
+ * comes before its bigrams.
+ */
+static int compare_keys(const BigramKey *first, const BigramKey *second)
+{
+  int result = compare_bytes (first->first, first->first_size,
+                              second->first, second->first_size);
+  if (result != 0)
+  {
+    return result;
+  }
+  if (first->second == NULL || second->second == NULL)
+  {
+    return (first->second != NULL) - (second->second != NULL);
+  }
+  return compare_bytes (first->second, first->second_size,
+                        second->second, second->second_size);
+}
+
+static int compare_entries(const void *first, const void *second)
+{
+  BigramKey first_key = entry_key (*(BigramEntry *const *) first);
+  BigramKey second_key = entry_key (*(BigramEntry *const *) second);
+  return compare_keys (&first_key, &second_key);
+}
+
+static size_t hash_key(const BigramKey *key)
+{
+  size_t hash = hash_bytes (FNV_OFFSET_BASIS, key->first, key->first_size);
+  // Tell apart a first without second from a bigram with an empty second
+  hash = (hash ^ (key->second != NULL)) * FNV_PRIME;
+  return hash_bytes (hash, key->second, key->second_size);
+}
+
+BigramCounter *new_bigram_counter(size_t memory_limit)
+{
+  if (memory_limit < MIN_MEMORY_LIMIT)
+  {
+    return NULL;
+  }
+  size_t file_buffer_size = memory_limit / IO_BUFFER_SHARE;
+  if (file_buffer_size < MIN_IO_BUFFER_SIZE)
+  {
+    file_buffer_size = MIN_IO_BUFFER_SIZE;
+  }
+  if (file_buffer_size > MAX_IO_BUFFER_SIZE)
+  {
+    file_buffer_size = MAX_IO_BUFFER_SIZE;
+  }
+  // A SLOTS_SHARE of the table goes to the slots, the rest to the arena
+  size_t table_limit = memory_limit - file_buffer_size;
+  size_t num_of_slots = MIN_NUM_OF_SLOTS;
+  while (num_of_slots * 2 * sizeof (BigramEntry *)
+         <= table_limit / SLOTS_SHARE)
+  {
+    num_of_slots *= 2;
+  }
+  BigramCounter *counter = malloc (sizeof (*counter));
+  if (counter == NULL)
+  {
+    return NULL;
+  }
+  size_t arena_capacity = table_limit - num_of_slots * sizeof (BigramEntry *);
+  *counter = (BigramCounter) {malloc (arena_capacity), 0, arena_capacity,
+                              calloc (num_of_slots, sizeof (BigramEntry *)),
+                              num_of_slots, 0, memory_limit,
+                              malloc (file_buffer_size), file_buffer_size,
+                              NULL, NULL, 0, 0, 0};
+  if (counter->arena == NULL || counter->slots == NULL
+      || counter->file_buffer == NULL)
+  {
+    free_bigram_counter (&counter);
+    return NULL;
+  }
+  return counter;
+}
+
+static int write_varint(FILE *fp, uint64_t value, size_t *written)
+{
+  unsigned char bytes[MAX_VARINT_SIZE];
+  size_t size = (size_t) encode_varint (value, bytes);
+  if (fwrite (bytes, 1, size, fp) != size)
+  {
+    return 1;
+  }
+  *written += size;
+  return 0;
+}
+
+/**
+ * Read the next bytes of the run into the buffer of the cursor.
+ * @return 0 in case of success, 1 at the end of the run or on error
+ */
+static int fill_cursor(RunCursor *cursor)
+{
+  size_t size = cursor->buffer_size;
+  if ((unsigned long) (cursor->end - cursor->position) < size)
+  {
+    size = (size_t) (cursor->end - cursor->position);
+  }
+  if (size == 0 || fseek (cursor->fp, cursor->position, SEEK_SET) != 0
+      || fread (cursor->buffer, 1, size, cursor->fp) != size)
+  {
+    return 1;
+  }
+  cursor->position += (long) size;
+  cursor->buffered = size;
+  cursor->consumed = 0;
+  return 0;
+}
+
+/**
+ * Read the next byte of the run.
+ * @return the byte, EOF at the end of the run or on error
+ */
+static int cursor_getc(RunCursor *cursor)
+{
+  if (cursor->consumed == cursor->buffered && fill_cursor (cursor))
+  {
+    return EOF;
+  }
+  return cursor->buffer[cursor->consumed++];
+}
+
+/**
+ * Read the next size bytes of the run.
+ * @return 0 in case of success, 1 if the run is too short or on error
+ */
+static int cursor_read(RunCursor *cursor, unsigned char *bytes, size_t size)
+{
+  while (size > 0)
+  {
+    if (cursor->consumed == cursor->buffered && fill_cursor (cursor))
+    {
+      return 1;
+    }
+    size_t available = cursor->buffered - cursor->consumed;
+    size_t part = size < available ? size : available;
+    memcpy (bytes, cursor->buffer + cursor->consumed, part);
+    cursor->consumed += part;
+    bytes += part;
+    size -= part;
+  }
+  return 0;
+}
+
+static int read_varint(RunCursor *cursor, uint64_t *value)
+{
+  // Gather the bytes of the varint, which may span two reads of the run
+  unsigned char bytes[MAX_VARINT_SIZE];
+  int size = 0;
+  int byte;
+  do
+  {
+    byte = cursor_getc (cursor);
+    if (byte == EOF)
+    {
+      return 1;
+    }
+    bytes[size++] = (unsigned char) byte;
+  }
+  while ((byte & VARINT_CONTINUE_BIT) != 0 && size < MAX_VARINT_SIZE);
+  const unsigned char *pos = bytes;
+  return decode_varint (&pos, bytes + size, value);
+}
+
+/**
+ * Write one record of a run: first size and bytes, second size + 1 (0 for
+ * no second) and bytes, then the count.
+ * @return 0 in case of success, 1 in case of file error
+ */
+static int write_record(FILE *fp, const BigramKey *key, uint64_t count,
+                        size_t *written)
+{
+  uint64_t second_size = key->second == NULL ? 0 : key->second_size + 1;
+  // The bytes may be NULL when there are none
+  if (write_varint (fp, key->first_size, written)
+      || (key->first_size > 0
+          && fwrite (key->first, 1, key->first_size, fp) != key->first_size)
+      || write_varint (fp, second_size, written)
+      || (key->second_size > 0
+          && fwrite (key->second, 1, key->second_size, fp)
+             != key->second_size)
+      || write_varint (fp, count, written))
+  {
+    return 1;
+  }
+  *written += key->first_size + key->second_size;
+  return 0;
+}
+
+/**
+ * Create a temporary file for runs, writing through the given buffer.
+ * @return the file, NULL in case of file error
+ */
+static FILE *new_runs_file(unsigned char *buffer, size_t buffer_size)
+{
+  FILE *fp = tmpfile ();
+  if (fp != NULL
+      && setvbuf (fp, (char *) buffer, _IOFBF, buffer_size) != 0)
+  {
+    fclose (fp);
+    return NULL;
+  }
+  return fp;
+}
+
+/**
+ * Sort the entries of the table, append them as a new run to the runs
+ * file and empty the table.
+ * @return 0 in case of success, 1 in case of allocation or file error
+ */
+static int spill_run(BigramCounter *counter)
+{
+  long *temp = realloc (counter->run_starts,
+                        (counter->num_of_runs + 2) * sizeof (long));
+  if (temp == NULL)
+  {
+    return 1;
+  }
+  counter->run_starts = temp;
+  if (counter->runs == NULL)
+  {
+    counter->runs = new_runs_file (counter->file_buffer,
+                                   counter->file_buffer_size);
+    if (counter->runs == NULL)
+    {
+      return 1;
+    }
+    counter->run_starts[0] = 0;
+  }
+
+  // Gather the entries at the start of the slots, and sort them there
+  size_t num_of_entries = 0;
+  for (size_t i = 0; i < counter->num_of_slots; i++)
+  {
+    if (counter->slots[i] != NULL)
+    {
+      counter->slots[num_of_entries++] = counter->slots[i];
+    }
+  }
+  qsort (counter->slots, num_of_entries, sizeof (BigramEntry *),
+         compare_entries);
+  for (size_t i = 0; i < num_of_entries; i++)
+  {
+    BigramKey key = entry_key (counter->slots[i]);
+    if (write_record (counter->runs, &key, counter->slots[i]->count,
+                      &counter->spilled_bytes))
+    {
+      return 1;
+    }
+  }
+  // Runs are written one after the other, the offset is the bytes so far
+  counter->run_starts[++counter->num_of_runs] = (long) counter->spilled_bytes;
+
+  memset (counter->slots, 0, counter->num_of_slots * sizeof (BigramEntry *));
+  counter->num_of_entries = 0;
+  counter->arena_size = 0;
+  return fflush (counter->runs) != 0;
+}
+
+/**
+ * Find the slot of key in the table: the slot holding its entry, or the
+ * empty slot where it should be inserted.
+ */
+static size_t find_slot(BigramCounter *counter, const BigramKey *key)
+{
+  size_t mask = counter->num_of_slots - 1;
+  size_t slot = hash_key (key) & mask;
+  while (counter->slots[slot] != NULL)
+  {
+    BigramKey slot_key = entry_key (counter->slots[slot]);
+    if (compare_keys (&slot_key, key) == 0)
+    {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+int count_bigram(BigramCounter *counter, const unsigned char *first,
+                 size_t first_size, const unsigned char *second,
+                 size_t second_size)
+{
+  if (second == NULL)
+  {
+    second_size = 0;
+  }
+  BigramKey key = {first, first_size, second, second_size};
+  size_t slot = find_slot (counter, &key);
+  if (counter->slots[slot] != NULL)
+  {
+    counter->slots[slot]->count++;
+    return 0;
+  }
+
+  size_t size = sizeof (BigramEntry) + first_size + second_size;
+  size = (size + ENTRY_ALIGNMENT - 1) / ENTRY_ALIGNMENT * ENTRY_ALIGNMENT;
+  if (size > counter->arena_capacity || first_size >= NO_SECOND
+      || second_size >= NO_SECOND)
+  {
+    return 1;
+  }
+  // Spill when the arena or the slots (kept at most half full) are full
+  if (counter->arena_size + size > counter->arena_capacity
+      || (counter->num_of_entries + 1) * 2 > counter->num_of_slots)
+  {
+    if (spill_run (counter))
+    {
+      return 1;
+    }
+    slot = find_slot (counter, &key);
+  }
+
+  BigramEntry *entry = (BigramEntry *) (counter->arena + counter->arena_size);
+  *entry = (BigramEntry) {1, (uint32_t) first_size,
+                          second == NULL ? NO_SECOND
+                                         : (uint32_t) second_size};
+  unsigned char *bytes = (unsigned char *) (entry + 1);
+  if (first_size > 0)
+  {
+    memcpy (bytes, first, first_size);
+  }
+  if (second_size > 0)
+  {
+    memcpy (bytes + first_size, second, second_size);
+  }
+  counter->arena_size += size;
+  counter->slots[slot] = entry;
+  counter->num_of_entries++;
+  return 0;
+}
+
+/**
+ * Read the next record of the run into the cursor.
+ * @return 0 in case of success, 1 at the end of the run or on error
+ * (the cursor's fp is set to NULL at a clean end)
+ */
+static int advance_cursor(RunCursor *cursor)
+{
+  uint64_t first_size;
+  uint64_t second_size;
+  if (cursor->consumed == cursor->buffered
+      && cursor->position == cursor->end)
+  {
+    cursor->fp = NULL;
+    return 1;
+  }
+  if (read_varint (cursor, &first_size) || first_size >= NO_SECOND)
+  {
+    return 1;
+  }
+  // Read the first bytes, then the second size and bytes after them
+  if (first_size + 1 > cursor->capacity)
+  {
+    unsigned char *temp = realloc (cursor->bytes, first_size + 1);
+    if (temp == NULL)
+    {
+      return 1;
+    }
+    cursor->bytes = temp;
+    cursor->capacity = first_size + 1;
+  }
+  if (cursor_read (cursor, cursor->bytes, first_size)
+      || read_varint (cursor, &second_size) || second_size > NO_SECOND)
+  {
+    return 1;
+  }
+  size_t total = first_size + (second_size == 0 ? 0 : second_size - 1);
+  if (total + 1 > cursor->capacity)
+  {
+    unsigned char *temp = realloc (cursor->bytes, total + 1);
+    if (temp == NULL)
+    {
+      return 1;
+    }
+    cursor->bytes = temp;
+    cursor->capacity = total + 1;
+  }
+  if (cursor_read (cursor, cursor->bytes + first_size, total - first_size)
+      || read_varint (cursor, &cursor->count))
+  {
+    return 1;
+  }
+  cursor->key = (BigramKey) {cursor->bytes, first_size,
+                             second_size == 0 ? NULL
+                                              : cursor->bytes + first_size,
+                             total - first_size};
+  return 0;
+}
+
+/**
+ * Restore the min-heap order of the cursors below index.
+ */
+static void sift_down(RunCursor **heap, int heap_size, int index)
+{
+  while (1)
+  {
+    int smallest = index;
+    for (int child = 2 * index + 1; child <= 2 * index + 2; child++)
+    {
+      if (child < heap_size
+          && compare_keys (&heap[child]->key, &heap[smallest]->key) < 0)
+      {
+        smallest = child;
+      }
+    }
+    if (smallest == index)
+    {
+      return;
+    }
+    RunCursor *temp = heap[index];
+    heap[index] = heap[smallest];
+    heap[smallest] = temp;
+    index = smallest;
+  }
+}
+
+/**
+ * Get the node of the data with the given bytes, adding it to the chain
+ * if needed.
+ * @return the node, NULL in case of allocation failure
+ */
+static MarkovNode *merge_data(MergeState *state, const unsigned char *bytes,
+                              size_t size)
+{
+  void *data = state->from_bytes (bytes, size);
+  if (data == NULL)
+  {
+    return NULL;
+  }
+  Node *node = add_data_to_database (state->markov_chain, data);
+  if ((node == NULL || node->data->data != data)
+      && state->markov_chain->free_data != NULL)
+  {
+    // The chain already has this data, or could not take it
+    state->markov_chain->free_data (data);
+  }
+  return node == NULL ? NULL : node->data;
+}
+
+/**
+ * Add a merged bigram and its total count to the chain, or to the output
+ * run.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int merge_bigram(MergeState *state, const BigramKey *key,
+                        uint64_t count)
+{
+  if (state->output != NULL)
+  {
+    return write_record (state->output, key, count, &state->output_size);
+  }
+  // Bigrams come sorted by first, so its node is usually the last one
+  if (state->first_node == NULL
+      || compare_bytes (state->first, state->first_size, key->first,
+                        key->first_size) != 0)
+  {
+    unsigned char *temp = realloc (state->first, key->first_size + 1);
+    if (temp == NULL)
+    {
+      return 1;
+    }
+    state->first = temp;
+    memcpy (state->first, key->first, key->first_size);
+    state->first_size = key->first_size;
+    state->first_node = merge_data (state, key->first, key->first_size);
+    if (state->first_node == NULL)
+    {
+      return 1;
+    }
+  }
+  if (key->second == NULL)
+  {
+    return 0;
+  }
+  MarkovNode *second_node = merge_data (state, key->second, key->second_size);
+  return second_node == NULL || count > INT_MAX
+         || add_frequency_to_list (state->first_node, second_node,
+                                   (int) count);
+}
+
+/**
+ * k-way merge num_of_runs runs of the counter, from first_run on.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int merge_runs(BigramCounter *counter, int first_run, int num_of_runs,
+                      MergeState *state)
+{
+  RunCursor *cursors = calloc (num_of_runs + 1, sizeof (*cursors));
+  RunCursor **heap = malloc ((num_of_runs + 1) * sizeof (*heap));
+  int heap_size = 0;
+  int result = cursors == NULL || heap == NULL;
+  for (int i = 0; i < num_of_runs && result == 0; i++)
+  {
+    cursors[i].fp = counter->runs;
+    cursors[i].buffer = malloc (counter->file_buffer_size);
+    cursors[i].buffer_size = counter->file_buffer_size;
+    cursors[i].position = counter->run_starts[first_run + i];
+    cursors[i].end = counter->run_starts[first_run + i + 1];
+    if (cursors[i].buffer == NULL)
+    {
+      result = 1;
+    }
+    else if (advance_cursor (&cursors[i]) == 0)
+    {
+      heap[heap_size++] = &cursors[i];
+    }
+    else
+    {
+      result = cursors[i].fp != NULL;
+    }
+  }
+  for (int i = heap_size / 2 - 1; i >= 0; i--)
+  {
+    sift_down (heap, heap_size, i);
+  }
+
+  BigramKey key = {NULL, 0, NULL, 0};
+  unsigned char *key_bytes = NULL;
+  while (heap_size > 0 && result == 0)
+  {
+    // Sum the counts of the smallest bigram over all runs
+    RunCursor *smallest = heap[0];
+    size_t size = smallest->key.first_size + smallest->key.second_size;
+    unsigned char *temp = realloc (key_bytes, size + 1);
+    if (temp == NULL)
+    {
+      result = 1;
+      break;
+    }
+    key_bytes = temp;
+    memcpy (key_bytes, smallest->bytes, size);
+    key = (BigramKey) {key_bytes, smallest->key.first_size,
+                       smallest->key.second == NULL
+                       ? NULL : key_bytes + smallest->key.first_size,
+                       smallest->key.second_size};
+    uint64_t count = 0;
+    while (heap_size > 0 && compare_keys (&heap[0]->key, &key) == 0)
+    {
+      count += heap[0]->count;
+      if (advance_cursor (heap[0]) != 0)
+      {
+        if (heap[0]->fp != NULL)
+        {
+          result = 1;
+          break;
+        }
+        heap[0] = heap[--heap_size];
+      }
+      sift_down (heap, heap_size, 0);
+    }
+    result = result || merge_bigram (state, &key, count);
+  }
+
+  for (int i = 0; cursors != NULL && i < num_of_runs; i++)
+  {
+    free (cursors[i].buffer);
+    free (cursors[i].bytes);
+  }
+  free (key_bytes);
+  free (cursors);
+  free (heap);
+  return result;
+}
+
+/**
+ * Merge each fan_in consecutive runs of the counter into one run of a new
+ * runs file, which replaces the current one.
+ * @return 0 in case of success, 1 otherwise
+ */
+static int merge_pass(BigramCounter *counter, int fan_in)
+{
+  int num_of_runs = (counter->num_of_runs + fan_in - 1) / fan_in;
+  long *run_starts = malloc ((num_of_runs + 1) * sizeof (long));
+  unsigned char *buffer = malloc (counter->file_buffer_size);
+  FILE *output = buffer == NULL ? NULL
+                                : new_runs_file (buffer,
+                                                 counter->file_buffer_size);
+  int result = run_starts == NULL || output == NULL;
+
+  MergeState state = {NULL, NULL, NULL, 0, NULL, output, 0};
+  for (int run = 0; run < num_of_runs && result == 0; run++)
+  {
+    int first_run = run * fan_in;
+    int count = counter->num_of_runs - first_run < fan_in
+                ? counter->num_of_runs - first_run : fan_in;
+    run_starts[run] = (long) state.output_size;
+    result = merge_runs (counter, first_run, count, &state);
+  }
+  result = result || fflush (output) != 0;
+  if (result)
+  {
+    if (output != NULL)
+    {
+      fclose (output);
+    }
+    free (buffer);
+    free (run_starts);
+    return 1;
+  }
+  run_starts[num_of_runs] = (long) state.output_size;
+
+  // Temporary files are deleted when closed
+  fclose (counter->runs);
+  free (counter->file_buffer);
+  free (counter->run_starts);
+  counter->runs = output;
+  counter->file_buffer = buffer;
+  counter->run_starts = run_starts;
+  counter->num_of_runs = num_of_runs;
+  counter->num_of_merge_passes++;
+  return 0;
+}
+
+int merge_bigram_counter(BigramCounter *counter, MarkovChain *markov_chain,
+                         from_bytes_func from_bytes)
+{
+  if (counter->arena == NULL
+      || (counter->num_of_entries > 0 && spill_run (counter)))
+  {
+    return 1;
+  }
+  // Give the memory of the table back before the merge buffers and the
+  // chain take it
+  free (counter->arena);
+  counter->arena = NULL;
+  free (counter->slots);
+  counter->slots = NULL;
+
+  // A buffer per merged run, besides the buffers of the runs files
+  int fan_in = (int) (counter->memory_limit / counter->file_buffer_size)
+               - MERGE_FILE_BUFFERS;
+  while (counter->num_of_runs > fan_in)
+  {
+    if (merge_pass (counter, fan_in))
+    {
+      return 1;
+    }
+  }
+
+  MergeState state = {markov_chain, from_bytes, NULL, 0, NULL, NULL, 0};
+  int result = merge_runs (counter, 0, counter->num_of_runs, &state);
+  free (state.first);
+  return result;
+}
+
+void free_bigram_counter(BigramCounter **ptr_counter)
+{
+  if ((*ptr_counter)->runs != NULL)
+  {
+    // Temporary files are deleted when closed
+    fclose ((*ptr_counter)->runs);
+  }
+  free ((*ptr_counter)->run_starts);
+  free ((*ptr_counter)->file_buffer);
+  free ((*ptr_counter)->arena);
+  free ((*ptr_counter)->slots);
+  free (*ptr_counter);
+  *ptr_counter = NULL;
+}
+
+long get_peak_resident_memory(void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+  {
+    return -1;
+  }
+  // Linux reports kilobytes
+  return usage.ru_maxrss;
+}
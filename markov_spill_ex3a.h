@@ -0,0 +1,107 @@
+#ifndef _MARKOV_SPILL_H_
+#define _MARKOV_SPILL_H_
+
+#include "markov_chain_ex3a.h"
+#include "markov_snapshot_ex3a.h" // For from_bytes_func
+
+#define MIN_MEMORY_LIMIT 4096
+
+/**
+ * @brief Counts bigrams of a corpus in bounded memory.
+ *
+ * Counts are kept in a fixed-size table. When the table is full, its
+ * entries are sorted and appended as a run to a temporary file, and the
+ * table is emptied. merge_bigram_counter merges all runs into a chain.
+ *
+ * @struct BigramCounter
+ * @field arena Holds the entries of the table.
+ * @field arena_size Bytes of arena in use.
+ * @field arena_capacity Size of arena.
+ * @field slots Open addressing hash table of the entries in arena.
+ * @field num_of_slots Number of slots (a power of 2).
+ * @field num_of_entries Number of entries in the table.
+ * @field memory_limit The memory budget of the counter.
+ * @field file_buffer Buffer of the runs file, part of the budget.
+ * @field file_buffer_size Size of file_buffer, and of each buffer the
+ *        merge reads a run through.
+ * @field runs Temporary file holding the sorted runs one after the other,
+ *        NULL until the first spill.
+ * @field run_starts Offset of each run in runs, followed by the end of the
+ *        last run.
+ * @field num_of_runs Number of runs in runs.
+ * @field num_of_merge_passes Number of times the runs were merged into
+ *        fewer, longer runs before the final merge into the chain.
+ * @field spilled_bytes Total size of the runs spilled while counting.
+ */
+typedef struct BigramCounter
+{
+    unsigned char *arena;
+    size_t arena_size;
+    size_t arena_capacity;
+    struct BigramEntry **slots;
+    size_t num_of_slots;
+    size_t num_of_entries;
+    size_t memory_limit;
+    unsigned char *file_buffer;
+    size_t file_buffer_size;
+    FILE *runs;
+    long *run_starts;
+    int num_of_runs;
+    int num_of_merge_passes;
+    size_t spilled_bytes;
+} BigramCounter;
+
+/**
+ * Create a counter whose table and file buffer take memory_limit bytes.
+ * @param memory_limit - bytes for the counter, at least MIN_MEMORY_LIMIT
+ * @return the new counter, NULL in case of memory allocation failure or a
+ * too small limit.
+ */
+BigramCounter *new_bigram_counter(size_t memory_limit);
+
+/**
+ * Count one occurrence of second following first, both given as the bytes
+ * to_bytes would return for them.
+ * @param counter
+ * @param first - bytes of the first data
+ * @param first_size - number of bytes of the first data
+ * @param second - bytes of the second data, NULL to only count first in
+ * the vocabulary (e.g. a line of a single word)
+ * @param second_size - number of bytes of the second data
+ * @return 0 in case of success, 1 in case of allocation or file error
+ */
+int count_bigram(BigramCounter *counter, const unsigned char *first,
+                 size_t first_size, const unsigned char *second,
+                 size_t second_size);
+
+/**
+ * Merge everything counted into an empty markov_chain. The table is freed
+ * first, and the runs are merged through buffers that fit in the memory
+ * limit together: if there are too many runs for that, groups of runs are
+ * merged into longer runs in a new temporary file until there are few
+ * enough. Beyond the memory limit, the merge holds the current record of
+ * each merged run (as long as its data) and the merged chain itself, which
+ * is not bounded. The counter cannot count anymore afterwards.
+ * @param counter
+ * @param markov_chain - empty chain to fill
+ * @param from_bytes - creates the data of the chain from bytes, stored as
+ * is and freed with free_data
+ * @return 0 in case of success, 1 otherwise
+ */
+int merge_bigram_counter(BigramCounter *counter, MarkovChain *markov_chain,
+                         from_bytes_func from_bytes);
+
+/**
+ * Free the counter and delete its runs.
+ * @param ptr_counter counter to free
+ */
+void free_bigram_counter(BigramCounter **ptr_counter);
+
+/**
+ * Get the peak resident memory of the process so far, to check memory
+ * limits against.
+ * @return the peak resident set size in kilobytes, -1 if unavailable
+ */
+long get_peak_resident_memory(void);
+
+#endif /* _MARKOV_SPILL_H_ */
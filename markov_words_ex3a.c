@@ -0,0 +1,231 @@
+#include "markov_words_ex3a.h"
+#include "markov_bytes_ex3a.h"
+#include <string.h>
+
+/**
+* Check if the given word ends a sentence (ends with '.').
+ * @param data - given word
+ * @return true if the word is the last word of a sentence, false otherwise
+ */
+bool is_last_word(void *data)
+{
+  const char *word = data;
+  size_t length_of_word = strlen (word);
+  return length_of_word > 0 && word[length_of_word - 1] == '.';
+}
+
+/**
+* Print a word of a tweet, followed by a space unless it ends the sentence
+ * @param data - given word
+ */
+void print_word(void *data)
+{
+  printf ("%s", (char *) data);
+  if (!is_last_word (data))
+  {
+    printf (" ");
+  }
+}
+
+/**
+* Compare two words
+ * @return 0 if the words are equal (like strcmp)
+ */
+int compare_words(void *first, void *second)
+{
+  return strcmp (first, second);
+}
+
+/**
+* Copy a word into newly allocated memory
+ * @param data - given word
+ * @return the copy, NULL in case of allocation failure
+ */
+void *copy_word(void *data)
+{
+  char *word = malloc (strlen (data) + 1);
+  if (word != NULL)
+  {
+    strcpy (word, data);
+  }
+  return word;
+}
+
+/**
+* Hash a word (FNV-1a)
+ * @param data - given word
+ * @return hash of the word
+ */
+size_t hash_word(void *data)
+{
+  return hash_bytes (FNV_OFFSET_BASIS, data, strlen (data));
+}
+
+/**
+* Get the bytes of a word for a snapshot, without its terminating '\0'
+ * @param data - given word
+ * @param size - where to store the number of bytes
+ * @return the bytes of the word
+ */
+const unsigned char *word_to_bytes(void *data, size_t *size)
+{
+  *size = strlen (data);
+  return data;
+}
+
+/**
+* Create a word from its bytes in a snapshot
+ * @param bytes - the bytes of the word
+ * @param size - number of bytes
+ * @return the word, NULL in case of allocation failure
+ */
+void *word_from_bytes(const unsigned char *bytes, size_t size)
+{
+  char *word = malloc (size + 1);
+  if (word != NULL)
+  {
+    memcpy (word, bytes, size);
+    word[size] = '\0';
+  }
+  return word;
+}
+
+/**
+* Read one line from the file and fill the database
+ * @param words_to_read - given integer, the number of word to read
+ * @param markov_chain - given pointer to markovchain
+ * @param flag - given pointer flag, to know when to stop read words
+ * @param written_words - given pointer written_words , to know when to
+ * stop read words
+ * @param line - given line
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database_one_line(int words_to_read, MarkovChain
+*markov_chain, int *flag,int *written_words, char line[])
+{
+  char *current_word;
+  Node *previous_node_word;
+  Node *add_node;
+
+  current_word = strtok (line, DELIMITERS);
+
+  if(current_word == NULL)
+  {
+    return  0;
+  }
+  add_node = add_to_database (markov_chain,current_word);
+  if(add_node == NULL)
+  {
+    return 1;
+  }
+  else
+  {
+    *written_words = *written_words + 1;
+    current_word = strtok (NULL, DELIMITERS);
+    previous_node_word = add_node;
+  }
+  if (words_to_read != READ_ALL_WORDS && *written_words == words_to_read)
+  {
+    *flag = 0;
+  }
+  while (current_word != NULL && *flag ==1)
+  {
+    add_node = add_to_database (markov_chain, current_word);
+    if(add_node == NULL)
+    {
+      return 1;
+    }
+    if(add_node_to_frequency_list(previous_node_word->data,
+                                   add_node->data ) == 1)
+    {
+      return 1;
+    }
+    *written_words = *written_words + 1;
+    previous_node_word = add_node;
+    if(words_to_read != READ_ALL_WORDS)
+    {
+      if (*written_words == words_to_read)
+      {
+        *flag = 0;
+      }
+    }
+    current_word = strtok (NULL, DELIMITERS);
+  }
+  return 0;
+}
+
+
+/**
+* Fill database from the given file
+ * @param fp - given pointer to the file
+ * @param words_to_read - given integer, the number of word to read
+ * @param markov_chain - given pointer to markovchain
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain)
+{
+
+  char line[MAX_LINE];
+  int written_words = 0;
+  int flag = 1;
+
+// Read line from file
+  while (flag && fgets (line, MAX_LINE, fp) != NULL)
+  {
+    // Read line
+    line[strcspn (line, "\n")] = '\0';
+
+    if(fill_database_one_line (words_to_read,markov_chain,&flag,
+                               &written_words,line) == 1)
+    {
+      return 1;
+    }
+
+  }
+  return 0;
+}
+
+/**
+* Fill database from the given file like fill_database, counting the
+ * bigrams in bounded memory first (spilling them to disk when the memory
+ * limit of counter is hit), then merging them into the chain. Data is
+ * added in byte order rather than in order of appearance.
+ * @param fp - given pointer to the file
+ * @param words_to_read - given integer, the number of word to read, or
+ * READ_ALL_WORDS
+ * @param markov_chain - given pointer to markovchain of words
+ * @param counter - given empty bigram counter, holds how much was spilled
+ * and merged afterwards
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database_in_memory_limit(FILE *fp, int words_to_read,
+                                  MarkovChain *markov_chain,
+                                  BigramCounter *counter)
+{
+  char line[MAX_LINE];
+  int written_words = 0;
+  int result = 0;
+  while (result == 0 && written_words != words_to_read
+         && fgets (line, MAX_LINE, fp) != NULL)
+  {
+    const char *previous = NULL;
+    for (char *word = strtok (line, DELIMITERS);
+         word != NULL && result == 0 && written_words != words_to_read;
+         word = strtok (NULL, DELIMITERS))
+    {
+      // The first word of a line is counted on its own, like a last word
+      const char *first = previous == NULL ? word : previous;
+      const char *second = previous == NULL ? NULL : word;
+      result = count_bigram (counter, (const unsigned char *) first,
+                             strlen (first), (const unsigned char *) second,
+                             second == NULL ? 0 : strlen (second));
+      previous = word;
+      written_words++;
+    }
+  }
+  if (result == 0)
+  {
+    result = merge_bigram_counter (counter, markov_chain, word_from_bytes);
+  }
+  return result;
+}
@@ -0,0 +1,107 @@
+#ifndef _MARKOV_WORDS_H_
+#define _MARKOV_WORDS_H_
+
+#include "markov_chain_ex3a.h"
+#include "markov_snapshot_ex3a.h" // For to_bytes_func, from_bytes_func
+#include "markov_spill_ex3a.h"
+
+#define READ_ALL_WORDS -1
+#define MAX_LINE 1000
+#define DELIMITERS " \n\t\r"
+
+/**
+ * Callbacks of a chain of words (NUL-terminated strings, ending a sentence
+ * when they end with '.'), shared by the tweets generator and the tests.
+ */
+
+/**
+* Check if the given word ends a sentence (ends with '.').
+ * @param data - given word
+ * @return true if the word is the last word of a sentence, false otherwise
+ */
+bool is_last_word(void *data);
+
+/**
+* Print a word of a tweet, followed by a space unless it ends the sentence
+ * @param data - given word
+ */
+void print_word(void *data);
+
+/**
+* Compare two words
+ * @return 0 if the words are equal (like strcmp)
+ */
+int compare_words(void *first, void *second);
+
+/**
+* Copy a word into newly allocated memory
+ * @param data - given word
+ * @return the copy, NULL in case of allocation failure
+ */
+void *copy_word(void *data);
+
+/**
+* Hash a word (FNV-1a)
+ * @param data - given word
+ * @return hash of the word
+ */
+size_t hash_word(void *data);
+
+/**
+* Get the bytes of a word for a snapshot, without its terminating '\0'
+ * @param data - given word
+ * @param size - where to store the number of bytes
+ * @return the bytes of the word
+ */
+const unsigned char *word_to_bytes(void *data, size_t *size);
+
+/**
+* Create a word from its bytes in a snapshot
+ * @param bytes - the bytes of the word
+ * @param size - number of bytes
+ * @return the word, NULL in case of allocation failure
+ */
+void *word_from_bytes(const unsigned char *bytes, size_t size);
+
+/**
+* Read one line from the file and fill the database
+ * @param words_to_read - given integer, the number of word to read
+ * @param markov_chain - given pointer to markovchain
+ * @param flag - given pointer flag, to know when to stop read words
+ * @param written_words - given pointer written_words , to know when to
+ * stop read words
+ * @param line - given line
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database_one_line(int words_to_read, MarkovChain
+*markov_chain, int *flag,int *written_words, char line[]);
+
+/**
+* Fill database from the given file, a bigram for each two words following
+ * each other in a line
+ * @param fp - given pointer to the file
+ * @param words_to_read - given integer, the number of word to read, or
+ * READ_ALL_WORDS
+ * @param markov_chain - given pointer to markovchain of words
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain);
+
+/**
+* Fill database from the given file like fill_database, counting the
+ * bigrams in bounded memory first (spilling them to disk when the memory
+ * limit of counter is hit), then merging them into the chain. Data is
+ * added in byte order rather than in order of appearance.
+ * @param fp - given pointer to the file
+ * @param words_to_read - given integer, the number of word to read, or
+ * READ_ALL_WORDS
+ * @param markov_chain - given pointer to markovchain of words
+ * @param counter - given empty bigram counter, holds how much was spilled
+ * and merged afterwards
+ * @return 0 in case of success, 1 otherwise
+ */
+int fill_database_in_memory_limit(FILE *fp, int words_to_read,
+                                  MarkovChain *markov_chain,
+                                  BigramCounter *counter);
+
+#endif /* _MARKOV_WORDS_H_ */
@@ -1,177 +1,177 @@
 
 #include "stdio.h"
 #include "markov_chain_ex3a.h"
+#include "markov_snapshot_ex3a.h"
+#include "markov_spill_ex3a.h"
+#include "markov_words_ex3a.h"
 #include "string.h"
 #include "ctype.h"
+#include <errno.h>
 #include <stdlib.h>
 
 #define FILE_PATH_ERROR "Error: incorrect file path"
 #define NUM_ARGS_ERROR "Usage: invalid number of arguments"
+#define MEMORY_LIMIT_ERROR "Usage: the memory limit must be a number of at "\
+            "least %d bytes"
+#define NO_FIRST_WORD_ERROR "Error: no word in the file can start a tweet\n"
+#define SNAPSHOT_LOAD_ERROR "Error: invalid snapshot\n"
+#define SNAPSHOT_SAVE_ERROR "Error: failed to write the snapshot\n"
+#define SAVE_OPTION "--save"
+#define LOAD_OPTION "--load"
+#define MEMORY_LIMIT_OPTION "--memory-limit"
+#define NO_MEMORY_LIMIT 0
+#define MEMORY_STATS_FORMAT "Spilled %zu bytes, merged in %d extra passes, "\
+            "peak resident memory %ld KB\n"
+#define SNAPSHOT_THREADS 4
 
-#define READ_ALL_WORDS -1
 #define FOUR_ARGUMENTS 4
 #define FIVE_ARGUMENTS 5
 #define BASE_TEN 10
 #define MAX_WORDS 20
-#define MAX_LINE 1000
-#define DELIMITERS " \n\t\r"
 
 /**
-* Read one line from the file and fill the database
+ * @brief The options given before the other arguments.
+ *
+ * @struct Options
+ * @field save_path Where to write a snapshot of the database, NULL not to.
+ * @field load Whether the input file is a snapshot instead of a text file.
+ * @field memory_limit Bytes to count the bigrams of the text file in, or
+ *        NO_MEMORY_LIMIT to fill the database directly.
+ */
+typedef struct Options
+{
+    char *save_path;
+    bool load;
+    size_t memory_limit;
+} Options;
+
+/**
+* Fill database from the given file with fill_database_in_memory_limit,
+ * then print how much was spilled and the peak memory to stderr.
  * @param fp - given pointer to the file
  * @param words_to_read - given integer, the number of word to read
  * @param markov_chain - given pointer to markovchain
- * @param flag - given pointer flag, to know when to stop read words
- * @param written_words - given pointer written_words , to know when to
- * stop read words
- * @param line - given line
- * database.
+ * @param memory_limit - memory of the bigram counter, in bytes
  * @return 0 in case of success, 1 otherwise
  */
-int fill_database_one_line(int words_to_read, MarkovChain
-*markov_chain, int *flag,int *written_words, char line[])
+int fill_database_and_report_memory(FILE *fp, int words_to_read,
+                                    MarkovChain *markov_chain,
+                                    size_t memory_limit)
 {
-  char *current_word;
-  Node *previous_node_word;
-  Node *add_node;
-
-  current_word = strtok (line, DELIMITERS);
-
-  if(current_word == NULL)
-  {
-    return  0;
-  }
-  add_node = add_to_database (markov_chain,current_word);
-  if(add_node == NULL)
+  BigramCounter *counter = new_bigram_counter (memory_limit);
+  if (counter == NULL)
   {
     return 1;
   }
-  else
-  {
-    *written_words = *written_words + 1;
-    current_word = strtok (NULL, DELIMITERS);
-    previous_node_word = add_node;
-  }
-  while (current_word != NULL && *flag ==1)
+  int result = fill_database_in_memory_limit (fp, words_to_read,
+                                              markov_chain, counter);
+  if (result == 0)
   {
-    add_node = add_to_database (markov_chain, current_word);
-    if(add_node == NULL)
-    {
-      return 1;
-    }
-    if(add_node_to_frequency_list(previous_node_word->data,
-                                   add_node->data ) == 1)
-    {
-      return 1;
-    }
-    *written_words = *written_words + 1;
-    previous_node_word = add_node;
-    if(words_to_read != READ_ALL_WORDS)
-    {
-      if (*written_words == words_to_read)
-      {
-        *flag = 0;
-      }
-    }
-    current_word = strtok (NULL, DELIMITERS);
+    fprintf (stderr, MEMORY_STATS_FORMAT, counter->spilled_bytes,
+             counter->num_of_merge_passes, get_peak_resident_memory ());
   }
-  return 0;
+  free_bigram_counter (&counter);
+  return result;
 }
 
-
 /**
-* Fill database from the given file
- * @param fp - given pointer to the file
- * @param words_to_read - given integer, the number of word to read
+* print tweets
  * @param markov_chain - given pointer to markovchain
- * @return 0 in case of success, 1 otherwise
+ * @param num_of_tweets - given integer, the number of tweets
+ * @return 0 in case of success, 1 if no word can start a tweet
  */
-int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain)
+int print_tweets(MarkovChain *markov_chain, int num_of_tweets)
 {
 
-  char line[MAX_LINE];
-  int written_words = 0;
-  int flag = 1;
+  MarkovNode *first_random;
 
-// Read line from file
-  while (fgets (line, MAX_LINE, fp) != NULL && flag)
+  for (int i = 0; i < num_of_tweets; i++)
   {
-    // Read line
-    line[strcspn (line, "\n")] = '\0';
 
-    if(fill_database_one_line (words_to_read,markov_chain,&flag,
-                               &written_words,line) == 1)
+    first_random = get_first_random_node (markov_chain);
+    if (first_random == NULL)
     {
       return 1;
     }
-
+    printf ("Tweet ");
+    printf ("%d",i+1);
+    printf (": ");
+    generate_tweet (markov_chain,first_random,MAX_WORDS);
+    printf ("\n");
   }
   return 0;
 }
 
 /**
-* generate tweet
- * @param first_node - given pointer to node of the first word
- * @param max_length - given integer, the number max words in the tweet
+* Parse the bytes of a memory limit option: only decimal digits, at least
+ * MIN_MEMORY_LIMIT
+ * @param text - given argument
+ * @param memory_limit - where to store the memory limit
+ * @return 0 in case of success, 1 otherwise
  */
-void generate_tweet(MarkovNode *first_node, int max_length)
+int parse_memory_limit(const char *text, size_t *memory_limit)
 {
-  // Variables definition
-  int i = 1;
-  int flag = 1;
-  int length_of_word;
-
-  // Pointers definition
-  MarkovNode *current_random;
-
-  current_random = first_node;
-
-  // Print the first random word
-  printf ("%s", current_random->data);
-  printf (" ");
-
-  // get random nodes as long as the node is not end of sentence or max tweets
-  while ( i < max_length && flag == 1)
+  char *end;
+  errno = 0;
+  unsigned long value = strtoul (text, &end, BASE_TEN);
+  // strtoul would skip spaces and accept a sign, negating the value
+  if (!isdigit ((unsigned char) text[0]) || *end != '\0' || errno == ERANGE
+      || value < MIN_MEMORY_LIMIT)
   {
-    // get the next random node
-    current_random = get_next_random_node (current_random);
-    printf ("%s", current_random->data);
-    i++;
-    // In case the word is not end of sentence
-    length_of_word = strlen (current_random->data);
-    if (current_random->data[length_of_word-1] != '.')
-    {
-      printf (" ");
-    }
-    // in case is end of sentence
-    else
-    {
-      flag = 0;
-    }
+    return 1;
   }
+  *memory_limit = value;
+  return 0;
 }
 
 /**
-* print tweets
- * @param markov_chain - given pointer to markovchain
- * @param num_of_tweets - given integer, the number of tweets
+* Take the options, given before the other arguments, out of the
+ * arguments: "--save FILE" writes a snapshot of the database to FILE,
+ * "--load" reads the database from a snapshot instead of a text file, and
+ * "--memory-limit BYTES" counts the bigrams of the text file in BYTES of
+ * memory, spilling them to disk (see fill_database_in_memory_limit).
+ * @param argc - given pointer to the number of arguments, updated
+ * @param argv - given pointer to the arguments, updated
+ * @param options - where to store the options
+ * @return 0 in case of success, 1 otherwise
  */
-void print_tweets(MarkovChain *markov_chain, int num_of_tweets)
+int take_options(int *argc, char **argv[], Options *options)
 {
-
-  MarkovNode *first_random;
-
-  for (int i = 0; i < num_of_tweets; i++)
+  int taken = 0;
+  *options = (Options) {NULL, false, NO_MEMORY_LIMIT};
+  while (taken + 1 < *argc && strncmp ((*argv)[taken + 1], "--", 2) == 0)
   {
-
-    first_random = get_first_random_node (markov_chain);
-    printf ("Tweet ");
-    printf ("%d",i+1);
-    printf (": ");
-    generate_tweet (first_random,MAX_WORDS);
-    printf ("\n");
+    char *option = (*argv)[taken + 1];
+    if (strcmp (option, LOAD_OPTION) == 0)
+    {
+      options->load = true;
+      taken++;
+    }
+    else if (strcmp (option, SAVE_OPTION) == 0 && taken + 2 < *argc)
+    {
+      options->save_path = (*argv)[taken + 2];
+      taken += 2;
+    }
+    else if (strcmp (option, MEMORY_LIMIT_OPTION) == 0 && taken + 2 < *argc)
+    {
+      if (parse_memory_limit ((*argv)[taken + 2], &options->memory_limit))
+      {
+        printf (MEMORY_LIMIT_ERROR, MIN_MEMORY_LIMIT);
+        return 1;
+      }
+      taken += 2;
+    }
+    else
+    {
+      printf (NUM_ARGS_ERROR);
+      return 1;
+    }
   }
-
+  // Keep the program name first
+  (*argv)[taken] = (*argv)[0];
+  *argv += taken;
+  *argc -= taken;
+  return 0;
 }
 
 /**
@@ -205,35 +205,85 @@ int check_arguments(int argc, char *argv[],int *number_of_words_to_read,
   }
 }
 
+/**
+ * @brief Writes a snapshot of the Markov chain database to a file.
+ *
+ * @param save_path Path of the snapshot file.
+ * @param markov_chain Pointer to the MarkovChain structure.
+ * @return 0 on success, 1 on failure.
+ */
+int save_snapshot(const char *save_path, MarkovChain *markov_chain)
+{
+  FILE *file = fopen (save_path, "wb");
+  if (file == NULL)
+  {
+    return 1;
+  }
+  int result = save_database (file, markov_chain, word_to_bytes);
+  if (fclose (file) != 0)
+  {
+    result = 1;
+  }
+  return result;
+}
+
 /**
  * @brief Fills the Markov chain database and prints generated tweets.
  *
- * This function reads words from a file into the Markov chain. If successful,
- * it generates and prints tweets. Otherwise, it prints an error message.
+ * This function reads words from a file (or a snapshot) into the Markov
+ * chain, and saves a snapshot of it if asked to. If successful, it
+ * generates and prints tweets. Otherwise, it prints an error message.
  *
- * @param file Pointer to the file containing input text.
+ * @param file Pointer to the file containing input text, or a snapshot.
  * @param markov_chain Pointer to the MarkovChain structure.
- * @param num_of_words_to_read Number of words to read from the file.
+ * @param num_of_words_to_read Number of words to read from the file,
+ *        ignored for a snapshot.
  * @param num_of_tweets Number of tweets to generate.
+ * @param options How to read the file, and where to save a snapshot.
  * @return 0 on success, 1 on failure.
  */
 
 int fill_database_and_print(FILE *file,MarkovChain *markov_chain, int
-num_of_words_to_read, int num_of_tweets)
+num_of_words_to_read, int num_of_tweets, const Options *options)
 {
-  if ( fill_database (file, num_of_words_to_read,
-                      markov_chain) == 0)
+  int result = 0;
+  if (options->load)
   {
-    print_tweets (markov_chain, num_of_tweets);
-    free_database (&markov_chain);
+    if (load_database (file, markov_chain, word_from_bytes,
+                       SNAPSHOT_THREADS) != 0)
+    {
+      printf (SNAPSHOT_LOAD_ERROR);
+      result = 1;
+    }
   }
-  else
+  else if (options->memory_limit != NO_MEMORY_LIMIT)
+  {
+    if (fill_database_and_report_memory (file, num_of_words_to_read,
+                                         markov_chain,
+                                         options->memory_limit) != 0)
+    {
+      printf (ALLOCATION_ERROR_MASSAGE);
+      result = 1;
+    }
+  }
+  else if (fill_database (file, num_of_words_to_read, markov_chain) != 0)
   {
     printf (ALLOCATION_ERROR_MASSAGE);
-    free_database (&markov_chain);
-    return 1;
+    result = 1;
   }
-  return 0;
+  if (result == 0 && options->save_path != NULL
+      && save_snapshot (options->save_path, markov_chain) != 0)
+  {
+    printf (SNAPSHOT_SAVE_ERROR);
+    result = 1;
+  }
+  if (result == 0 && print_tweets (markov_chain, num_of_tweets) != 0)
+  {
+    printf (NO_FIRST_WORD_ERROR);
+    result = 1;
+  }
+  free_database (&markov_chain);
+  return result;
 }
 
 /**
@@ -244,10 +294,12 @@ num_of_words_to_read, int num_of_tweets)
  * initializes memory, and handles errors appropriately.
  *
  * @param argc Number of command-line arguments.
- * @param argv Array of command-line arguments.
+ * @param argv Array of command-line arguments, after the options
+ *             "--save FILE", "--load" and "--memory-limit BYTES" (see
+ *             take_options).
  *             - argv[1]: Number of words to read from the file.
  *             - argv[2]: Number of tweets to generate.
- *             - argv[3]: File path of the input text.
+ *             - argv[3]: File path of the input text, or of a snapshot.
  *
  * @return EXIT_SUCCESS (0) if the program runs successfully, EXIT_FAILURE (1) on error.
  */
@@ -257,60 +309,45 @@ int main(int argc, char *argv[])
   int num_of_words_to_read = 0;
   int num_of_tweets = 0;
   int seed = 0;
+  int result = EXIT_SUCCESS;
+  Options options;
 
-  MarkovChain *markov_chain = malloc (sizeof (*markov_chain));
+  // Check if input is valid
+  if(take_options (&argc, &argv, &options) != 0
+     || check_arguments (argc,argv,&num_of_words_to_read,&num_of_tweets,
+                         &seed) != 0)
+  {
+    return EXIT_FAILURE;
+  }
 
-  // Faild to allocate memory
-  if(markov_chain == NULL)
+  FILE *file_to_read;
+  file_to_read = fopen (argv[3], options.load ? "rb" : "r");
+  if(file_to_read == NULL)
   {
-    printf (ALLOCATION_ERROR_MASSAGE);
-    EXIT_FAILURE;
+    printf (FILE_PATH_ERROR);
+    return EXIT_FAILURE;
   }
 
-  LinkedList *linked_list = malloc (sizeof (*linked_list));
+  MarkovChain *markov_chain = new_markov_chain (print_word, compare_words,
+                                                free, copy_word,
+                                                is_last_word, hash_word);
 
   // Faild to allocate memory
-  if(linked_list == NULL)
+  if(markov_chain == NULL)
   {
     printf (ALLOCATION_ERROR_MASSAGE);
-    EXIT_FAILURE;
+    fclose (file_to_read);
+    return EXIT_FAILURE;
   }
-  linked_list->first = NULL;
-  linked_list->last=NULL;
-  linked_list->size = 0;
-  markov_chain->database = linked_list;
 
-  // Check if input is valid
-  if(check_arguments (argc,argv,&num_of_words_to_read,&num_of_tweets,&seed)
-     == 0)
+  srand (seed);
+  // fill_database_and_print frees the chain in both cases
+  if(fill_database_and_print (file_to_read,markov_chain,
+                              num_of_words_to_read,num_of_tweets,
+                              &options) != 0)
   {
-    srand (seed);
-    FILE *file_to_read;
-    file_to_read = fopen (argv[3],"r");
-    if(file_to_read)
-    {
-
-      if(fill_database_and_print (file_to_read,markov_chain,
-                                  num_of_words_to_read,num_of_tweets)==0)
-      {
-        fclose (file_to_read);
-        EXIT_SUCCESS;
-      }
-      else
-      {
-        EXIT_FAILURE;
-      }
-    }
-    else
-    {
-      printf (FILE_PATH_ERROR);
-      EXIT_FAILURE;
-    }
-  }
-  else
-  {
-    EXIT_FAILURE;
+    result = EXIT_FAILURE;
   }
+  fclose (file_to_read);
+  return result;
 }
-
-